@@ -0,0 +1,102 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <climits>
+
+// 计时器
+class BenchTimer {
+public:
+    BenchTimer() : start_(std::chrono::steady_clock::now()) {}
+
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 吞吐量（MB/s，1 MB = 1,000,000 字节）
+inline double megabytesPerSecond(uint64_t bytes, double seconds) {
+    return seconds > 0 ? static_cast<double>(bytes) / 1e6 / seconds : 0.0;
+}
+
+// 多次测量取中位数
+double median(std::vector<double> values);
+
+// 把文件的页缓存丢掉，使下一次读取从磁盘开始（只丢弃干净页，无需 root；不支持的平台什么也不做）
+bool dropFileCache(const std::string& path);
+
+// 把文件数据刷到磁盘
+bool syncFile(const std::string& path);
+
+// file_zip_bench io {file} [--repeat N]：比较各 I/O 后端的冷缓存读取与写入吞吐
+int runIoBench(int argc, char* argv[]);
+
+// 进程启动以来的堆分配次数（bench_alloc.cpp 替换了全局 operator new）
+uint64_t allocationCount();
+
+// 一种测试输入
+struct BenchInput {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+// 内存中基准测试的公共参数：[file] [--repeat N] [--size MB]
+struct BenchOptions {
+    std::string file;          // 可选的真实输入文件
+    int repeat = 5;            // 每项重复次数，取中位数
+    size_t synthetic_size = 16 * 1000 * 1000; // 合成输入的大小
+};
+
+// 解析公共参数（从 argv[2] 开始）；allow_file 为 false 时不接受输入文件
+bool parseBenchOptions(int argc, char* argv[], bool allow_file, BenchOptions& options);
+
+// 测试输入：random（不可压缩）、text（LogGenerator 生成的 W3C 日志），给出文件时再加上文件内容
+std::vector<BenchInput> loadBenchInputs(const BenchOptions& options);
+
+// 一项测量的结果：重复运行的中位耗时和单次运行的最少堆分配次数
+struct BenchResult {
+    double seconds = 0;
+    uint64_t allocations = 0;
+};
+
+// 运行 fn 共 repeat 次；fn 返回 false 表示结果校验失败
+template <typename Fn>
+bool measure(int repeat, Fn fn, BenchResult& result) {
+    std::vector<double> times;
+    uint64_t allocations = UINT64_MAX;
+    for (int r = 0; r < repeat; ++r) {
+        uint64_t before = allocationCount();
+        BenchTimer timer;
+        if (!fn()) return false;
+        times.push_back(timer.seconds());
+        uint64_t count = allocationCount() - before;
+        if (count < allocations) allocations = count;
+    }
+    result.seconds = median(times);
+    result.allocations = allocations;
+    return true;
+}
+
+// 打印表头与一行结果：MB/s、ns/byte、每 MB 的堆分配次数（都按 bytes 折算）
+void printBenchHeader(const char* first, const char* second);
+void printBenchRow(const std::string& first, const std::string& second, uint64_t bytes, const BenchResult& result);
+
+// file_zip_bench bitio [--repeat N] [--size MB]：各码宽下的 BitWriter::write / BitReader::read
+int runBitioBench(int argc, char* argv[]);
+
+// file_zip_bench lzw [file] [--repeat N] [--size MB]：各码宽、各输入下的 LZW 编码与解码
+int runLzwBench(int argc, char* argv[]);
+
+// file_zip_bench preprocess [file] [--repeat N] [--size MB]：替换表的整块与流式预处理/恢复
+int runPreprocessBench(int argc, char* argv[]);
+
+// file_zip_bench pipeline [file] [--repeat N] [--size MB]：内存中预处理 + 编码 + 位打包的完整流程及其逆过程
+int runPipelineBench(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "bench.h"
+#include "fileio.h"
+#include "bitio.h"
+#include "lzw_compress.h"
+#include "lzw_decompress.h"
+#include "preprocess.h"
+
+// 被测的码宽：初始宽度、默认宽度和两个较大的宽度
+static const int kCodeWidths[] = { 9, 12, 16, 20 };
+
+int runBitioBench(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseBenchOptions(argc, argv, false, options)) return -1;
+
+    std::cout << "BitWriter / BitReader, " << options.synthetic_size << " packed bytes per width, "
+        << options.repeat << " run(s), median; rates are per packed byte\n";
+    printBenchHeader("stage", "width");
+
+    for (int width = 9; width <= 20; ++width) {
+        // 随机码值，位数正好凑满 synthetic_size 字节
+        size_t count = options.synthetic_size * 8 / width;
+        std::vector<uint32_t> codes(count);
+        uint64_t state = 0x2545F4914F6CDD1Dull ^ static_cast<uint64_t>(width);
+        for (uint32_t& c : codes) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            c = static_cast<uint32_t>(state) & ((1u << width) - 1);
+        }
+
+        std::vector<uint8_t> packed;
+        packed.reserve(options.synthetic_size + 8);
+        BenchResult write_result;
+        bool ok = measure(options.repeat, [&]() {
+            packed.clear();
+            MemoryByteSink sink(packed);
+            BitWriter writer(sink);
+            for (uint32_t c : codes) {
+                writer.write(c, width);
+            }
+            return writer.flush();
+        }, write_result);
+
+        BenchResult read_result;
+        ok = ok && measure(options.repeat, [&]() {
+            MemoryByteSource source(packed.data(), packed.size());
+            BitReader reader(source);
+            uint32_t code = 0;
+            for (uint32_t c : codes) {
+                if (!reader.read(code, width) || code != c) return false;
+            }
+            return true;
+        }, read_result);
+
+        if (!ok) {
+            std::cerr << "Error: bit I/O round trip failed at width " << width << "\n";
+            return -1;
+        }
+        printBenchRow("BitWriter::write", std::to_string(width), packed.size(), write_result);
+        printBenchRow("BitReader::read", std::to_string(width), packed.size(), read_result);
+    }
+    return 0;
+}
+
+int runLzwBench(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseBenchOptions(argc, argv, true, options)) return -1;
+    std::vector<BenchInput> inputs = loadBenchInputs(options);
+    if (inputs.empty()) return -1;
+
+    std::cout << "LZW coder / decoder, " << options.repeat << " run(s), median; rates are per original byte\n";
+    printBenchHeader("stage/input", "width");
+
+    for (const BenchInput& input : inputs) {
+        for (int width : kCodeWidths) {
+            LZWCompressOptions lzw(9, width);
+            std::vector<uint8_t> compressed;
+            compressed.reserve(input.data.size() * 2 + 64);
+            BenchResult encode_result;
+            bool ok = measure(options.repeat, [&]() {
+                compressed.clear();
+                MemoryByteSink sink(compressed);
+                LZWCompressor compressor(lzw);
+                BitWriter writer(sink);
+                return compressor.compressBuffer(input.data.data(), input.data.size(), writer) && writer.flush();
+            }, encode_result);
+
+            std::vector<uint8_t> decoded(input.data.size());
+            BenchResult decode_result;
+            ok = ok && measure(options.repeat, [&]() {
+                MemoryByteSource source(compressed.data(), compressed.size());
+                SliceByteSink sink(decoded.data(), decoded.size());
+                BitReader reader(source);
+                LZWDecompressor decompressor(LZWDecompressOptions(9, width));
+                return decompressor.decompressStream(reader, sink) && sink.size() == decoded.size();
+            }, decode_result);
+
+            if (!ok || decoded != input.data) {
+                std::cerr << "Error: LZW round trip failed on " << input.name << " at width " << width << "\n";
+                return -1;
+            }
+            std::string label = std::to_string(width) + " (" + std::to_string(compressed.size() * 100 / std::max<size_t>(input.data.size(), 1)) + "%)";
+            printBenchRow("encode/" + input.name, label, input.data.size(), encode_result);
+            printBenchRow("decode/" + input.name, label, input.data.size(), decode_result);
+        }
+    }
+    return 0;
+}
+
+int runPipelineBench(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseBenchOptions(argc, argv, true, options)) return -1;
+    std::vector<BenchInput> inputs = loadBenchInputs(options);
+    if (inputs.empty()) return -1;
+
+    // 与 compressFile/decompressFile 的单一码流路径相同，只是输入输出都在内存中
+    std::cout << "End-to-end in memory (preprocess -> LZW -> bit packing and back), "
+        << options.repeat << " run(s), median; rates are per original byte\n";
+    printBenchHeader("stage/input", "mode");
+
+    preprocessor table;
+    for (const BenchInput& input : inputs) {
+        for (int width : { 12, 16 }) {
+            for (bool preprocess : { false, true }) {
+                std::vector<uint8_t> compressed;
+                compressed.reserve(input.data.size() * 2 + 64);
+                BenchResult zip_result;
+                bool ok = measure(options.repeat, [&]() {
+                    compressed.clear();
+                    MemoryByteSource raw(input.data.data(), input.data.size());
+                    preprocess_source preprocessed(table, raw);
+                    MemoryByteSink sink(compressed);
+                    BitWriter writer(sink);
+                    LZWCompressor compressor(LZWCompressOptions(9, width));
+                    ByteSource& source = preprocess ? static_cast<ByteSource&>(preprocessed) : raw;
+                    return compressor.compressStream(source, writer) && writer.flush();
+                }, zip_result);
+
+                std::vector<uint8_t> decoded(input.data.size());
+                BenchResult unzip_result;
+                ok = ok && measure(options.repeat, [&]() {
+                    MemoryByteSource source(compressed.data(), compressed.size());
+                    SliceByteSink file_sink(decoded.data(), decoded.size());
+                    restore_sink restorer(table, file_sink);
+                    ByteSink& sink = preprocess ? static_cast<ByteSink&>(restorer) : file_sink;
+                    BitReader reader(source);
+                    LZWDecompressor decompressor(LZWDecompressOptions(9, width));
+                    bool decoded_ok = decompressor.decompressStream(reader, sink);
+                    if (decoded_ok && preprocess) decoded_ok = restorer.finish();
+                    return decoded_ok && file_sink.size() == decoded.size();
+                }, unzip_result);
+
+                if (!ok || decoded != input.data) {
+                    std::cerr << "Error: pipeline round trip failed on " << input.name << "\n";
+                    return -1;
+                }
+                std::string mode = std::to_string(width) + (preprocess ? "+pre" : "");
+                printBenchRow("zip/" + input.name, mode, input.data.size(), zip_result);
+                printBenchRow("unzip/" + input.name, mode, input.data.size(), unzip_result);
+            }
+        }
+    }
+    return 0;
+}
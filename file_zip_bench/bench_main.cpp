@@ -0,0 +1,162 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include "bench.h"
+#include "fileio.h"
+#include "log_generator.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+bool dropFileCache(const std::string& path) {
+#if defined(__unix__) && defined(POSIX_FADV_DONTNEED)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    // 脏页不会被丢弃，先刷盘
+    fdatasync(fd);
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    ::close(fd);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool syncFile(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+bool parseBenchOptions(int argc, char* argv[], bool allow_file, BenchOptions& options) {
+    for (int i = 2; i < argc; ++i) {
+        std::string opt = argv[i];
+        if (opt == "--repeat" && i + 1 < argc) {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (opt == "--size" && i + 1 < argc) {
+            options.synthetic_size = static_cast<size_t>(std::max(1, std::atoi(argv[++i]))) * 1000 * 1000;
+        }
+        else if (allow_file && options.file.empty() && opt.compare(0, 2, "--") != 0) {
+            options.file = opt;
+        }
+        else {
+            std::cerr << "Error: unknown option '" << opt << "'\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// xorshift64，合成输入只需可重复、足够快
+static uint64_t nextRandom(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+std::vector<BenchInput> loadBenchInputs(const BenchOptions& options) {
+    std::vector<BenchInput> inputs(2);
+    inputs[0].name = "random";
+    inputs[0].data.resize(options.synthetic_size);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (uint8_t& b : inputs[0].data) {
+        b = static_cast<uint8_t>(nextRandom(state) >> 56);
+    }
+    inputs[1].name = "text";
+    LogGenerator().generateBuffer(inputs[1].data, options.synthetic_size);
+
+    if (!options.file.empty()) {
+        BufferedFileReader in;
+        if (!in.open(options.file) || !in.sizeKnown()) {
+            std::cerr << "Error: '" << options.file << "' is not a readable regular file\n";
+            return {};
+        }
+        BenchInput file;
+        file.name = "file";
+        file.data.resize(static_cast<size_t>(in.fileSize()));
+        if (!file.data.empty() && !in.readAt(0, file.data.data(), file.data.size())) {
+            std::cerr << "Error: failed to read '" << options.file << "'\n";
+            return {};
+        }
+        inputs.push_back(std::move(file));
+    }
+    return inputs;
+}
+
+void printBenchHeader(const char* first, const char* second) {
+    std::cout << std::left << std::setw(22) << first << std::setw(12) << second
+        << std::right << std::setw(12) << "MB/s" << std::setw(12) << "ns/byte" << std::setw(14) << "allocs/MB" << "\n";
+}
+
+void printBenchRow(const std::string& first, const std::string& second, uint64_t bytes, const BenchResult& result) {
+    double mb = static_cast<double>(bytes) / 1e6;
+    double ns_per_byte = bytes > 0 ? result.seconds * 1e9 / static_cast<double>(bytes) : 0.0;
+    std::cout << std::left << std::setw(22) << first << std::setw(12) << second << std::right << std::fixed
+        << std::setprecision(1) << std::setw(12) << megabytesPerSecond(bytes, result.seconds)
+        << std::setprecision(3) << std::setw(12) << ns_per_byte
+        << std::setprecision(2) << std::setw(14) << (mb > 0 ? static_cast<double>(result.allocations) / mb : 0.0) << "\n";
+}
+
+// 打印用法
+void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " {benchmark} [args]\n"
+        << "Benchmarks:\n"
+        << "  io {file} [--repeat N]                     cold-cache read / write throughput of each I/O backend\n"
+        << "  bitio [--repeat N] [--size MB]             BitWriter::write / BitReader::read at each code width\n"
+        << "  lzw [file] [--repeat N] [--size MB]        LZW encoder / decoder at each code width and input\n"
+        << "  preprocess [file] [--repeat N] [--size MB] replacement-table preprocess / restore, whole and streamed\n"
+        << "  pipeline [file] [--repeat N] [--size MB]   in-memory preprocess + LZW + bit packing and back\n"
+        << "  gen {out} --size N[K|M|G] [options]        write a deterministic synthetic W3C log\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return -1;
+    }
+
+    std::string name = argv[1];
+    if (name == "io") {
+        return runIoBench(argc, argv);
+    }
+    if (name == "bitio") {
+        return runBitioBench(argc, argv);
+    }
+    if (name == "lzw") {
+        return runLzwBench(argc, argv);
+    }
+    if (name == "preprocess") {
+        return runPreprocessBench(argc, argv);
+    }
+    if (name == "pipeline") {
+        return runPipelineBench(argc, argv);
+    }
+    if (name == "gen") {
+        return runGenerate(argc, argv);
+    }
+
+    printUsage(argv[0]);
+    std::cerr << "Error: unknown benchmark '" << name << "'\n";
+    return -1;
+}
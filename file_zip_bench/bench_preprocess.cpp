@@ -0,0 +1,73 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "bench.h"
+#include "fileio.h"
+#include "preprocess.h"
+
+int runPreprocessBench(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseBenchOptions(argc, argv, true, options)) return -1;
+    std::vector<BenchInput> inputs = loadBenchInputs(options);
+    if (inputs.empty()) return -1;
+
+    preprocessor table;
+    std::cout << "Replacement table (" << table.get_entries().size() << " entries), "
+        << options.repeat << " run(s), median; rates are per original byte\n";
+    printBenchHeader("stage/input", "size %");
+
+    for (const BenchInput& input : inputs) {
+        const std::string text(input.data.begin(), input.data.end());
+
+        // ӿڣpreprocess / restore
+        std::string processed;
+        BenchResult preprocess_result;
+        bool ok = measure(options.repeat, [&]() {
+            processed = table.preprocess(text);
+            return true;
+        }, preprocess_result);
+
+        std::string restored;
+        BenchResult restore_result;
+        ok = ok && measure(options.repeat, [&]() {
+            restored = table.restore(processed);
+            return restored.size() == text.size();
+        }, restore_result);
+
+        // ʽӿڣpreprocess_source / restore_sink 1 MB ֿ飩
+        std::vector<uint8_t> streamed(processed.size() + 1024);
+        size_t streamed_size = 0;
+        BenchResult source_result;
+        ok = ok && measure(options.repeat, [&]() {
+            MemoryByteSource raw(input.data.data(), input.data.size());
+            preprocess_source source(table, raw);
+            streamed_size = 0;
+            for (;;) {
+                size_t got = source.read(streamed.data() + streamed_size, streamed.size() - streamed_size);
+                if (got == 0) break;
+                streamed_size += got;
+            }
+            return streamed_size == processed.size();
+        }, source_result);
+
+        std::vector<uint8_t> sunk(input.data.size());
+        BenchResult sink_result;
+        ok = ok && measure(options.repeat, [&]() {
+            SliceByteSink out(sunk.data(), sunk.size());
+            restore_sink sink(table, out);
+            return sink.write(streamed.data(), streamed_size) && sink.finish() && out.size() == sunk.size();
+        }, sink_result);
+
+        if (!ok || restored != text || sunk != input.data) {
+            std::cerr << "Error: preprocess round trip failed on " << input.name << "\n";
+            return -1;
+        }
+        std::string ratio = std::to_string(processed.size() * 100 / std::max<size_t>(text.size(), 1));
+        printBenchRow("preprocess/" + input.name, ratio, text.size(), preprocess_result);
+        printBenchRow("restore/" + input.name, ratio, text.size(), restore_result);
+        printBenchRow("source/" + input.name, ratio, text.size(), source_result);
+        printBenchRow("restore_sink/" + input.name, ratio, text.size(), sink_result);
+    }
+    return 0;
+}
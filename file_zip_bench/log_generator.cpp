@@ -0,0 +1,313 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "bench.h"
+#include "log_generator.h"
+
+// 日期与天数互换（proleptic Gregorian，见 H. Hinnant 的 days_from_civil）
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+// 样本日志中出现过的三个 User-Agent 放在池首，其余由模板加版本号生成
+static const char* const kKnownAgents[] = {
+    "Mozilla/5.0+(Linux;+U;+Android+8.0.0;+en-us;+MIX+2+Build/OPR1.170623.027)+AppleWebKit/537.36+(KHTML,+like+Gecko)+Version/4.0+Chrome/61.0.3163.128+Mobile+Safari/537.36+XiaoMi/MiuiBrowser/10.5.2",
+    "Mozilla/5.0+(Windows+NT+6.3;+Win64;+x64)+AppleWebKit/537.36+(KHTML,+like+Gecko)+Chrome/72.0.3626.121+Safari/537.36",
+    "Mozilla/5.0+(Macintosh;+Intel+Mac+OS+X+10_13_6)+AppleWebKit/605.1.15+(KHTML,+like+Gecko)+Version/12.0.3+Safari/605.1.15",
+};
+
+// 模板参数依次为：主版本号、构建号、补丁号
+static const char* const kAgentTemplates[] = {
+    "Mozilla/5.0+(Windows+NT+10.0;+Win64;+x64)+AppleWebKit/537.36+(KHTML,+like+Gecko)+Chrome/%u.0.%u.%u+Safari/537.36",
+    "Mozilla/5.0+(Windows+NT+10.0;+Win64;+x64;+rv:%u.0)+Gecko/%u0101+Firefox/%u",
+    "Mozilla/5.0+(iPhone;+CPU+iPhone+OS+%u_1+like+Mac+OS+X)+AppleWebKit/605.1.15+(KHTML,+like+Gecko)+Mobile/15E%u+Safari/604.%u",
+    "Mozilla/5.0+(Linux;+Android+%u;+SM-G%u)+AppleWebKit/537.36+(KHTML,+like+Gecko)+Chrome/70.0.%u.80+Mobile+Safari/537.36",
+};
+
+// 样本日志中的常见路径，其余路径按静态资源与页面两类生成
+static const char* const kKnownUrls[] = {
+    "/login.php", "/default/******.php", "/default/******.htm", "/index.html",
+    "/files/assets/css/style.css", "/files/bower_components/jquery/dist/jquery.min.js",
+    "/files/assets/js/script.js", "/favicon.ico",
+};
+
+// (sc-status sc-substatus sc-win32-status)，按样本日志中的频率排序
+static const char* const kStatuses[] = {
+    "200 0 0", "304 0 0", "404 0 2", "200 0 64", "404 3 50",
+    "200 0 1236", "206 0 0", "302 0 0", "403 14 5", "500 0 0",
+};
+
+static const size_t kStatusCount = sizeof(kStatuses) / sizeof(kStatuses[0]);
+
+LogGenerator::LogGenerator(const LogGeneratorOptions& options)
+    : options_(options), state_(0), second_(0), in_second_(0), header_written_(false) {
+    // splitmix64 打散种子，避免相邻种子产生相关的序列
+    uint64_t z = options_.seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    state_ = (z ^ (z >> 31)) | 1;
+
+    int y = 2019;
+    unsigned m = 3, d = 13;
+    if (std::sscanf(options_.start_date.c_str(), "%d-%u-%u", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1 || d > 31) {
+        y = 2019; m = 3; d = 13;
+    }
+    day_ = daysFromCivil(y, m, d);
+    if (options_.lines_per_second == 0) options_.lines_per_second = 1;
+    buildPools();
+}
+
+uint64_t LogGenerator::next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return state_ * 0x2545F4914F6CDD1Dull;
+}
+
+uint32_t LogGenerator::pick(uint32_t n) {
+    if (n <= 1) return 0;
+    // u^3 把均匀分布压向 0：前 10% 的值约占一半的出现次数
+    double u = static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    uint32_t i = static_cast<uint32_t>(u * u * u * n);
+    return i < n ? i : n - 1;
+}
+
+void LogGenerator::buildPools() {
+    char buf[512];
+    uint32_t agent_count = std::max<uint32_t>(options_.user_agents, 1);
+    for (uint32_t i = 0; i < agent_count; ++i) {
+        if (i < 3) {
+            agents_.push_back(kKnownAgents[i]);
+            continue;
+        }
+        // 版本号中带上序号，保证池中各值互不相同
+        uint32_t r = static_cast<uint32_t>(next());
+        std::snprintf(buf, sizeof(buf), kAgentTemplates[i % 4], 8 + r % 64, 1000 + i, r % 200);
+        agents_.push_back(buf);
+    }
+
+    uint32_t url_count = std::max<uint32_t>(options_.urls, 1);
+    for (uint32_t i = 0; i < url_count; ++i) {
+        if (i < sizeof(kKnownUrls) / sizeof(kKnownUrls[0])) {
+            urls_.push_back(kKnownUrls[i]);
+            continue;
+        }
+        static const char* const kUrlTemplates[] = {
+            "/files/assets/images/%04x.png", "/default/problem_%u.php", "/files/assets/js/m%u.js", "/news/%u.html",
+        };
+        std::snprintf(buf, sizeof(buf), kUrlTemplates[i % 4], i);
+        urls_.push_back(buf);
+    }
+
+    queries_.push_back("-");
+    for (unsigned a = 1; a <= 9; ++a) {
+        for (unsigned b = 1; b <= 4; ++b) {
+            std::snprintf(buf, sizeof(buf), "problemid=%u_%u", a, b);
+            queries_.push_back(buf);
+        }
+    }
+
+    uint32_t ip_count = std::max<uint32_t>(options_.client_ips, 1);
+    for (uint32_t i = 0; i < ip_count; ++i) {
+        if (options_.mask_ips) {
+            ips_.push_back("***.***.***.***");
+            break;
+        }
+        uint64_t r = next();
+        std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u", static_cast<unsigned>(1 + r % 223),
+            static_cast<unsigned>((r >> 8) & 0xFF), static_cast<unsigned>((r >> 16) & 0xFF), static_cast<unsigned>(1 + (r >> 24) % 254));
+        ips_.push_back(buf);
+    }
+    server_ip_ = options_.mask_ips ? "***.***.***.***" : "10.0.0.1";
+
+    uint32_t status_count = std::min<uint32_t>(std::max<uint32_t>(options_.statuses, 1), kStatusCount);
+    statuses_.assign(kStatuses, kStatuses + status_count);
+}
+
+void LogGenerator::appendHeader(std::string& out) const {
+    int64_t y;
+    unsigned m, d;
+    civilFromDays(day_, y, m, d);
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "#Date: %04d-%02u-%02u %02u:%02u:%02u\r\n", static_cast<int>(y), m, d,
+        second_ / 3600, second_ / 60 % 60, second_ % 60);
+    out += "#Software: Hllpoj Server 1.0.1 / Logger 1.0.0 built 0001\r\n#Version: 1.0\r\n";
+    out += buf;
+    out += "#Fields: date time s-ip cs-method cs-uri-stem cs-uri-query s-port cs-username c-ip cs(User-Agent) cs(Referer) sc-status sc-substatus sc-win32-status time-taken\r\n";
+}
+
+void LogGenerator::appendLine(std::string& out) {
+    // 每秒的记录数在平均值附近波动；过了午夜换到下一天并重写指令行（同 IIS 的按天滚动）
+    uint32_t r = static_cast<uint32_t>(next());
+    if (in_second_ >= options_.lines_per_second / 2 + r % (options_.lines_per_second + 1)) {
+        in_second_ = 0;
+        if (++second_ >= 86400) {
+            second_ = 0;
+            ++day_;
+            header_written_ = false;
+        }
+    }
+    ++in_second_;
+    // 服务偶尔重启，重启后同样重写指令行
+    if (!header_written_ || (r >> 20) == 0) {
+        appendHeader(out);
+        header_written_ = true;
+    }
+
+    int64_t y;
+    unsigned m, d;
+    civilFromDays(day_, y, m, d);
+    const std::string& url = urls_[pick(static_cast<uint32_t>(urls_.size()))];
+    bool page = url.size() > 4 && url.compare(url.size() - 4, 4, ".php") == 0;
+    uint64_t r2 = next();
+    const char* method = page && (r2 & 3) != 0 ? "POST" : ((r2 >> 2) % 64 == 0 ? "HEAD" : "GET");
+    const std::string& query = page && (r2 >> 8) % 3 == 0 ? queries_[1 + pick(static_cast<uint32_t>(queries_.size() - 1))] : queries_[0];
+    const char* port = (r2 >> 16) % 10 == 0 ? "443" : "80";
+    const std::string& ip = ips_[pick(static_cast<uint32_t>(ips_.size()))];
+    const std::string& agent = agents_[pick(static_cast<uint32_t>(agents_.size()))];
+    const char* status = statuses_[pick(static_cast<uint32_t>(statuses_.size()))];
+    unsigned taken = static_cast<unsigned>(pick(page ? 3000 : 400));
+
+    char buf[1024];
+    int n = std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u %02u:%02u:%02u %s %s %s %s %s - %s %s ",
+        static_cast<int>(y), m, d, second_ / 3600, second_ / 60 % 60, second_ % 60,
+        server_ip_.c_str(), method, url.c_str(), query.c_str(), port, ip.c_str(), agent.c_str());
+    out.append(buf, static_cast<size_t>(n));
+    if ((r2 >> 24) % 10 < 3) {
+        out += '-';
+    }
+    else {
+        out += "http://";
+        out += server_ip_;
+        out += urls_[pick(static_cast<uint32_t>(urls_.size()))];
+    }
+    n = std::snprintf(buf, sizeof(buf), " %s %u\r\n", status, taken);
+    out.append(buf, static_cast<size_t>(n));
+}
+
+uint64_t LogGenerator::generate(ByteSink& out, uint64_t size) {
+    std::string chunk;
+    chunk.reserve(1024 * 1024 + 4096);
+    uint64_t total = 0;
+    while (total < size) {
+        chunk.clear();
+        while (chunk.size() < 1024 * 1024 && total + chunk.size() < size) {
+            appendLine(chunk);
+        }
+        if (!out.write(reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size())) return 0;
+        total += chunk.size();
+    }
+    return total;
+}
+
+void LogGenerator::generateBuffer(std::vector<uint8_t>& out, size_t size) {
+    out.clear();
+    out.reserve(size + 4096);
+    MemoryByteSink sink(out);
+    generate(sink, size);
+    out.resize(size);
+}
+
+// 解析带 K/M/G 后缀（1024 进制）的大小
+static bool parseSize(const char* text, uint64_t& size) {
+    char* end = nullptr;
+    unsigned long long v = std::strtoull(text, &end, 10);
+    if (end == text) return false;
+    switch (*end) {
+    case 'k': case 'K': v <<= 10; ++end; break;
+    case 'm': case 'M': v <<= 20; ++end; break;
+    case 'g': case 'G': v <<= 30; ++end; break;
+    default: break;
+    }
+    if (*end != '\0') return false;
+    size = v;
+    return true;
+}
+
+int runGenerate(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " gen {out} --size N[K|M|G] [--seed S] [--agents N] [--urls N]"
+            << " [--ips N] [--statuses N] [--rate N] [--date YYYY-MM-DD] [--mask-ips]\n";
+        return -1;
+    }
+    std::string path = argv[2];
+    LogGeneratorOptions options;
+    uint64_t size = 0;
+    for (int i = 3; i < argc; ++i) {
+        std::string opt = argv[i];
+        bool has_value = i + 1 < argc;
+        if (opt == "--size" && has_value) {
+            if (!parseSize(argv[++i], size)) {
+                std::cerr << "Error: --size must be a number with an optional K, M or G suffix\n";
+                return -1;
+            }
+        }
+        else if (opt == "--seed" && has_value) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (opt == "--agents" && has_value) {
+            options.user_agents = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (opt == "--urls" && has_value) {
+            options.urls = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (opt == "--ips" && has_value) {
+            options.client_ips = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (opt == "--statuses" && has_value) {
+            options.statuses = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (opt == "--rate" && has_value) {
+            options.lines_per_second = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (opt == "--date" && has_value) {
+            options.start_date = argv[++i];
+        }
+        else if (opt == "--mask-ips") {
+            options.mask_ips = true;
+        }
+        else {
+            std::cerr << "Error: unknown option '" << opt << "'\n";
+            return -1;
+        }
+    }
+    if (size == 0) {
+        std::cerr << "Error: --size is required\n";
+        return -1;
+    }
+
+    BufferedFileWriter out;
+    if (!out.open(path)) {
+        std::cerr << "Error: cannot open '" << path << "' for writing\n";
+        return -1;
+    }
+    out.preallocate(size);
+    BenchTimer timer;
+    LogGenerator generator(options);
+    uint64_t written = generator.generate(out, size);
+    if (written == 0 || !out.close()) {
+        std::cerr << "Error: failed to write '" << path << "'\n";
+        return -1;
+    }
+    std::cout << "Generated " << written << " bytes (seed " << options.seed << ") in "
+        << static_cast<uint64_t>(timer.seconds() * 1000) << " ms\n";
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef LOG_GENERATOR_H
+#define LOG_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "fileio.h"
+
+// 合成 IIS/W3C 扩展日志的参数
+// 各字段的取值池大小决定基数；池中靠前的值出现得更频繁（近似 Zipf 分布）
+struct LogGeneratorOptions {
+    uint64_t seed = 1;             // 随机种子，相同参数与种子生成完全相同的字节
+    uint32_t user_agents = 8;      // 不同 User-Agent 的个数
+    uint32_t urls = 64;            // 不同 cs-uri-stem 的个数
+    uint32_t client_ips = 1000;    // 不同 c-ip 的个数
+    uint32_t statuses = 5;         // 使用的 sc-status 种类数，1-10
+    uint32_t lines_per_second = 20; // 平均每秒的请求数，决定 time 字段的推进速度
+    std::string start_date = "2019-03-13"; // 第一条记录的日期，跨天后顺延
+    bool mask_ips = false;         // 与样本日志一样把地址写成 ***.***.***.***
+};
+
+// 确定性的 W3C 扩展日志生成器
+// 随机数与取样只用整数运算和 IEEE 乘法，不依赖标准库分布，跨平台输出一致
+class LogGenerator {
+public:
+    explicit LogGenerator(const LogGeneratorOptions& options = LogGeneratorOptions());
+
+    // 生成整行直到输出不少于 size 字节，返回实际写出的字节数（输出失败时返回 0）
+    uint64_t generate(ByteSink& out, uint64_t size);
+
+    // 生成恰好 size 字节（最后一行可能被截断），用于基准测试的内存输入
+    void generateBuffer(std::vector<uint8_t>& out, size_t size);
+
+private:
+    LogGeneratorOptions options_;
+    uint64_t state_;
+    std::vector<std::string> agents_;
+    std::vector<std::string> urls_;
+    std::vector<std::string> queries_;
+    std::vector<std::string> ips_;
+    std::vector<const char*> statuses_;
+    std::string server_ip_;
+    int64_t day_;          // 当前日期（自 1970-01-01 起的天数）
+    uint32_t second_;      // 当天已过的秒数
+    uint32_t in_second_;   // 当前秒内已生成的记录数
+    bool header_written_;
+
+    uint64_t next();
+    // [0, n) 内偏向小值的下标
+    uint32_t pick(uint32_t n);
+
+    void buildPools();
+    void appendHeader(std::string& out) const;
+    void appendLine(std::string& out);
+};
+
+// file_zip_bench gen {out} --size N[K|M|G] [options]：生成合成日志文件
+int runGenerate(int argc, char* argv[]);
+
+#endif
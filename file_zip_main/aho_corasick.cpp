@@ -0,0 +1,160 @@
+#include "aho_corasick.h"
+#include <algorithm>
+#include <queue>
+
+void aho_corasick::build(const std::vector<std::pair<std::string, std::string>>& rules) {
+    replacements.clear();
+    max_len = 0;
+
+    // 字母表压缩：模式中出现过的字节各占一类，其余字节共用类 0
+    std::fill(byte_class, byte_class + 256, 0);
+    class_count = 1;
+    for (const auto& rule : rules) {
+        for (unsigned char c : rule.first) {
+            if (byte_class[c] == 0) {
+                byte_class[c] = static_cast<uint16_t>(class_count++);
+            }
+        }
+    }
+
+    // 1. 建 trie（0 表示没有子节点，根不会成为子节点）
+    std::vector<uint32_t> child(class_count, 0);
+    depth.assign(1, 0);
+    match_len.assign(1, 0);
+    match_rule.assign(1, 0);
+    for (const auto& rule : rules) {
+        if (rule.first.empty()) continue;
+        uint32_t s = 0;
+        for (unsigned char c : rule.first) {
+            uint32_t& slot = child[s * class_count + byte_class[c]];
+            if (slot == 0) {
+                slot = static_cast<uint32_t>(depth.size());
+                depth.push_back(depth[s] + 1);
+                match_len.push_back(0);
+                match_rule.push_back(0);
+                child.resize(child.size() + class_count, 0);
+            }
+            s = child[s * class_count + byte_class[c]];
+        }
+        if (match_len[s] == 0) {
+            match_len[s] = static_cast<uint32_t>(rule.first.size());
+            match_rule[s] = static_cast<uint32_t>(replacements.size());
+            replacements.push_back(rule.second);
+            max_len = std::max(max_len, rule.first.size());
+        }
+    }
+
+    // 2. 按层 BFS 求失败链接并展开成 DFA；没有自己的匹配时继承失败状态的（更短后缀的）匹配
+    const size_t states = depth.size();
+    next.assign(states * class_count, 0);
+    std::vector<uint32_t> fail(states, 0);
+    std::queue<uint32_t> order;
+    for (size_t c = 0; c < class_count; ++c) {
+        uint32_t t = child[c];
+        next[c] = t;
+        if (t != 0) order.push(t);
+    }
+    while (!order.empty()) {
+        uint32_t s = order.front();
+        order.pop();
+        if (match_len[s] == 0 && match_len[fail[s]] != 0) {
+            match_len[s] = match_len[fail[s]];
+            match_rule[s] = match_rule[fail[s]];
+        }
+        for (size_t c = 0; c < class_count; ++c) {
+            uint32_t t = child[s * class_count + c];
+            if (t != 0) {
+                fail[t] = next[fail[s] * class_count + c];
+                next[s * class_count + c] = t;
+                order.push(t);
+            }
+            else {
+                next[s * class_count + c] = next[fail[s] * class_count + c];
+            }
+        }
+    }
+}
+
+void aho_corasick::replace_all(const uint8_t* data, size_t size, std::string& out) const {
+    stream_rewriter rewriter(*this);
+    rewriter.feed(data, size, out);
+    rewriter.finish(out);
+}
+
+void stream_rewriter::feed(const uint8_t* data, size_t size, std::string& out) {
+    carry.append(reinterpret_cast<const char*>(data), size);
+    scan(false, out);
+    compact();
+}
+
+void stream_rewriter::finish(std::string& out) {
+    scan(true, out);
+    carry.clear();
+    emitted = pos = 0;
+    state = 0;
+    has_candidate = false;
+}
+
+void stream_rewriter::scan(bool final, std::string& out) {
+    const size_t n = carry.size();
+    const uint8_t* buf = reinterpret_cast<const uint8_t*>(carry.data());
+
+    for (;;) {
+        while (pos < n) {
+            state = ac.step(state, buf[pos]);
+            pos++;
+
+            // 以 pos 结尾的最长匹配起点最靠左；起点更左、或起点相同而更长的匹配取代当前候选
+            uint32_t len = ac.match_len[state];
+            if (len != 0) {
+                size_t start = pos - len;
+                if (!has_candidate || start < cand_start || (start == cand_start && pos > cand_end)) {
+                    has_candidate = true;
+                    cand_start = start;
+                    cand_end = pos;
+                    cand_rule = ac.match_rule[state];
+                }
+            }
+
+            // 仍在进行中的部分匹配最早从 active 开始
+            size_t active = pos - ac.depth[state];
+            if (has_candidate) {
+                if (active > cand_start) {
+                    // 不会再有更左或更长的匹配：输出候选，从其末尾重新开始扫描
+                    out.append(carry, emitted, cand_start - emitted);
+                    out += ac.replacements[cand_rule];
+                    emitted = pos = cand_end;
+                    state = 0;
+                    has_candidate = false;
+                }
+            }
+            else if (active > emitted) {
+                // active 之前的字节不可能再属于任何匹配
+                out.append(carry, emitted, active - emitted);
+                emitted = active;
+            }
+        }
+
+        if (!final || !has_candidate) break;
+        // 输入已结束：候选即为最终匹配
+        out.append(carry, emitted, cand_start - emitted);
+        out += ac.replacements[cand_rule];
+        emitted = pos = cand_end;
+        state = 0;
+        has_candidate = false;
+    }
+
+    if (final) {
+        out.append(carry, emitted, n - emitted);
+        emitted = n;
+    }
+}
+
+void stream_rewriter::compact() {
+    if (emitted == 0) return;
+    carry.erase(0, emitted);
+    pos -= emitted;
+    cand_start -= has_candidate ? emitted : 0;
+    cand_end -= has_candidate ? emitted : 0;
+    emitted = 0;
+}
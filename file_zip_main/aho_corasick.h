@@ -0,0 +1,72 @@
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// 多模式替换自动机（Aho–Corasick，完全展开为 DFA）
+// 字母表按模式中出现过的字节压缩成若干类，转移表大小为 状态数 × 类数
+class aho_corasick {
+public:
+	// 由 (模式, 替换串) 列表构建；空模式忽略，重复的模式以第一个为准
+	void build(const std::vector<std::pair<std::string, std::string>>& rules);
+
+	bool empty() const { return replacements.empty(); }
+
+	size_t state_count() const { return depth.size(); }
+
+	size_t max_pattern_len() const { return max_len; }
+
+	// 一遍扫描替换 [data, data + size) 中的所有匹配（最左最长、互不重叠），结果追加到 out
+	void replace_all(const uint8_t* data, size_t size, std::string& out) const;
+
+private:
+	friend class stream_rewriter;
+
+	uint32_t step(uint32_t state, uint8_t byte) const {
+		return next[state * class_count + byte_class[byte]];
+	}
+
+	uint16_t byte_class[256] = {};  // 模式可能用到全部 256 个字节，类号最大为 256
+	size_t class_count = 1;
+	size_t max_len = 0;
+	std::vector<uint32_t> next;        // 转移表
+	std::vector<uint32_t> depth;       // 状态对应字符串的长度
+	std::vector<uint32_t> match_len;   // 以该状态结尾的最长模式长度，0 表示没有
+	std::vector<uint32_t> match_rule;  // 对应的规则号
+	std::vector<std::string> replacements;
+};
+
+// 流式替换：输入可以任意分块，跨块的部分匹配保存在内部，
+// 只缓存尚未确定的尾部（不超过两个最长模式长度）
+class stream_rewriter {
+public:
+	explicit stream_rewriter(const aho_corasick& automaton) : ac(automaton) {}
+
+	// 处理一块输入，已确定的输出追加到 out
+	void feed(const uint8_t* data, size_t size, std::string& out);
+
+	// 输入结束：处理剩余的尾部
+	void finish(std::string& out);
+
+	// 尚未输出的输入字节数
+	size_t pending_size() const { return carry.size() - emitted; }
+
+private:
+	const aho_corasick& ac;
+	std::string carry;       // 未确定的输入，从 emitted 开始有效
+	size_t emitted = 0;      // carry 中已输出（或已被替换）的前缀长度
+	size_t pos = 0;          // 下一个要扫描的位置
+	uint32_t state = 0;
+	bool has_candidate = false;
+	size_t cand_start = 0;
+	size_t cand_end = 0;
+	uint32_t cand_rule = 0;
+
+	void scan(bool final, std::string& out);
+	void compact();
+};
+
+#endif
@@ -1,99 +1,125 @@
 #include "bitio.h"
+#include "stats.h"
+#include "trace.h"
 #include <iostream>
+#include <cstring>
 
-BitWriter::BitWriter(std::ofstream& out)
-    : out_(out), buffer_(0), buffer_bits_(0), bits_written_(0) {
+BitWriter::BitWriter(std::ofstream& out, size_t block_size)
+    : owned_sink_(new StreamByteSink(out)), sink_(owned_sink_.get()),
+    pos_(0), acc_(0), acc_bits_(0), bits_written_(0), error_(false) {
+    block_.resize(block_size < 64 ? 64 : block_size);
 }
 
-BitWriter::~BitWriter() {
-    flush();
+BitWriter::BitWriter(ByteSink& sink, size_t block_size)
+    : sink_(&sink), pos_(0), acc_(0), acc_bits_(0), bits_written_(0), error_(false) {
+    block_.resize(block_size < 64 ? 64 : block_size);
 }
 
-bool BitWriter::write(uint32_t code, int width) {
-    if (width <= 0 || width > 32) return false;
-    if (!out_.good()) return false;
-
-    bits_written_ += width;
-
-    // ӵ
-    buffer_ |= (code << buffer_bits_);
-    buffer_bits_ += width;
-
-    // 8λʱдֽ
-    while (buffer_bits_ >= 8) {
-        uint8_t byte = static_cast<uint8_t>(buffer_ & 0xFF);
-        out_.put(static_cast<char>(byte));
-        if (!out_.good()) return false;
-
-        buffer_ >>= 8;
-        buffer_bits_ -= 8;
+BitWriter::~BitWriter() {
+    if (pos_ > 0 || acc_bits_ > 0) {
+        flush();
     }
+}
 
-    return true;
+bool BitWriter::drain() {
+    StageScope stage(Stage::BitPack);
+    TraceScope trace("BitWriter::drain", "bitio");
+    stage.addBytes(pos_, pos_);
+    trace.setBytes(pos_);
+    if (pos_ > 0 && !error_) {
+        if (!sink_->write(block_.data(), pos_)) {
+            error_ = true;
+        }
+    }
+    pos_ = 0;
+    return !error_;
 }
 
 bool BitWriter::flush() {
-    if (!out_.good()) return false;
-
-    // ʣλ0д
-    if (buffer_bits_ > 0) {
-        uint8_t byte = static_cast<uint8_t>(buffer_ & 0xFF);
-        out_.put(static_cast<char>(byte));
-        buffer_ = 0;
-        buffer_bits_ = 0;
+    // 将累加器中的剩余位（不足的部分补0）写入输出块
+    while (acc_bits_ > 0) {
+        block_[pos_++] = static_cast<uint8_t>(acc_);
+        acc_ >>= 8;
+        acc_bits_ = acc_bits_ > 8 ? acc_bits_ - 8 : 0;
     }
+    acc_ = 0;
 
-    out_.flush();
-    return out_.good();
+    if (!drain()) return false;
+    if (!sink_->flush()) {
+        error_ = true;
+    }
+    return !error_;
 }
 
-BitReader::BitReader(std::ifstream& in)
-    : in_(in), buffer_(0), buffer_bits_(0), bits_read_(0), eof_reached_(false) {
+BitReader::BitReader(std::ifstream& in, size_t block_size)
+    : owned_source_(new StreamByteSource(in)), source_(owned_source_.get()),
+    pos_(0), end_(0), acc_(0), acc_bits_(0), bits_read_(0), eof_reached_(false) {
+    block_.resize(block_size < 64 ? 64 : block_size);
 }
 
-bool BitReader::read(uint32_t& code, int width) {
-    if (width <= 0 || width > 32) return false;
+BitReader::BitReader(ByteSource& source, size_t block_size)
+    : source_(&source),
+    pos_(0), end_(0), acc_(0), acc_bits_(0), bits_read_(0), eof_reached_(false) {
+    block_.resize(block_size < 64 ? 64 : block_size);
+}
 
-    code = 0;
+void BitReader::fillBlock() {
+    StageScope stage(Stage::BitPack);
+    TraceScope trace("BitReader::fillBlock", "bitio");
+    size_t remaining = end_ - pos_;
+    if (remaining > 0 && pos_ > 0) {
+        std::memmove(block_.data(), block_.data() + pos_, remaining);
+    }
+    pos_ = 0;
+    end_ = remaining;
 
-    // ȷ㹻λ
-    while (buffer_bits_ < width && !eof_reached_) {
-        if (!fillBuffer()) {
+    while (end_ < 8 && !eof_reached_) {
+        size_t got = source_->read(block_.data() + end_, block_.size() - end_);
+        if (got == 0) {
             eof_reached_ = true;
             break;
         }
+        end_ += got;
+        stage.addBytes(got, got);
     }
+}
 
-    if (buffer_bits_ < width) {
-        // û㹻λɶ
-        return false;
+void BitReader::refill() {
+    if (end_ - pos_ < 8 && !eof_reached_) {
+        fillBlock();
     }
 
-    // ӻȡָλ
-    uint32_t mask = (1U << width) - 1;
-    code = buffer_ & mask;
-    buffer_ >>= width;
-    buffer_bits_ -= width;
-    bits_read_ += width;
+    if (end_ - pos_ >= 8) {
+        // 非对齐加载 8 字节（小端），只前移累加器能容纳的整字节数
+        const uint8_t* p = block_.data() + pos_;
+        uint64_t word = uint64_t(p[0]) | (uint64_t(p[1]) << 8) |
+            (uint64_t(p[2]) << 16) | (uint64_t(p[3]) << 24) |
+            (uint64_t(p[4]) << 32) | (uint64_t(p[5]) << 40) |
+            (uint64_t(p[6]) << 48) | (uint64_t(p[7]) << 56);
+        acc_ |= word << acc_bits_;
+        pos_ += (63 - acc_bits_) >> 3;
+        acc_bits_ |= 56;
+    }
+    else {
+        // 输入末尾：逐字节补充
+        while (acc_bits_ <= 56 && pos_ < end_) {
+            acc_ |= uint64_t(block_[pos_++]) << acc_bits_;
+            acc_bits_ += 8;
+        }
+    }
+}
 
+bool BitReader::readAlignedBytes(uint8_t* buf, size_t size) {
+    // 累加器按整字节装入，当前字节剩余的填充位一定已在累加器中
+    consume(static_cast<int>((8 - bits_read_ % 8) % 8));
+    for (size_t i = 0; i < size; ++i) {
+        uint32_t byte;
+        if (!read(byte, 8)) return false;
+        buf[i] = static_cast<uint8_t>(byte);
+    }
     return true;
 }
 
 bool BitReader::hasMore() const {
-    return buffer_bits_ > 0 || (!eof_reached_ && in_.good());
-}
-
-bool BitReader::fillBuffer() {
-    if (!in_.good()) return false;
-
-    int byte = in_.get();
-    if (byte == EOF) {
-        return false;
-    }
-
-    // ֽӵĸλ
-    buffer_ |= (static_cast<uint32_t>(static_cast<uint8_t>(byte)) << buffer_bits_);
-    buffer_bits_ += 8;
-
-    return true;
+    return acc_bits_ > 0 || pos_ < end_ || !eof_reached_;
 }
\ No newline at end of file
@@ -4,36 +4,119 @@
 #include <fstream>
 #include <cstdint>
 #include <vector>
+#include <memory>
+#include "fileio.h"
 
 // λдɱλĴд뵽ֽ
+// 64 λۼÿ 32 λдڲ飬д齻
 class BitWriter {
 public:
-    explicit BitWriter(std::ofstream& out);
+    static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    explicit BitWriter(std::ofstream& out, size_t block_size = DEFAULT_BLOCK_SIZE);
+    explicit BitWriter(ByteSink& sink, size_t block_size = DEFAULT_BLOCK_SIZE);
     ~BitWriter();
 
-    // дָλĴ
-    bool write(uint32_t code, int width);
+    BitWriter(const BitWriter&) = delete;
+    BitWriter& operator=(const BitWriter&) = delete;
+
+    // дָλĴ루1-32 λ
+    bool write(uint32_t code, int width) {
+        if (width <= 0 || width > 32) {
+            error_ = true;
+            return false;
+        }
+
+        bits_written_ += width;
+
+        // ۼ 31 λ 32 λҲ
+        acc_ |= (static_cast<uint64_t>(code) & ((uint64_t(1) << width) - 1)) << acc_bits_;
+        acc_bits_ += width;
+
+        if (acc_bits_ >= 32) {
+            uint32_t word = static_cast<uint32_t>(acc_);
+            uint8_t* p = block_.data() + pos_;
+            p[0] = static_cast<uint8_t>(word);
+            p[1] = static_cast<uint8_t>(word >> 8);
+            p[2] = static_cast<uint8_t>(word >> 16);
+            p[3] = static_cast<uint8_t>(word >> 24);
+            pos_ += 4;
+            acc_ >>= 32;
+            acc_bits_ -= 32;
 
-    // ˢ»ʣλ0д
+            if (pos_ + 4 > block_.size()) {
+                drain();
+            }
+        }
+
+        return !error_;
+    }
+
+    // ˢ»ʣλ0д
     bool flush();
 
+    // Ƿд󣨴״̬һλԶ
+    bool good() const { return !error_; }
+
     // ȡдλ
     uint64_t getBitsWritten() const { return bits_written_; }
 
 private:
-    std::ofstream& out_;
-    uint32_t buffer_;       // λ
-    int buffer_bits_;       // еЧλ
-    uint64_t bits_written_; // дλ
+    std::unique_ptr<ByteSink> owned_sink_;
+    ByteSink* sink_;
+    std::vector<uint8_t> block_; // 
+    size_t pos_;                 // ֽ
+    uint64_t acc_;               // λۼ
+    int acc_bits_;               // ۼеЧλ
+    uint64_t bits_written_;      // дλ
+    bool error_;                 // ״̬
+
+    // 齻
+    bool drain();
 };
 
 // λȡֽȡɱλĴ
+// ˶ڲ飬ÿ 8 ֽڷǶز 64 λۼ
 class BitReader {
 public:
-    explicit BitReader(std::ifstream& in);
+    static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
 
-    // ȡָλĴ
-    bool read(uint32_t& code, int width);
+    explicit BitReader(std::ifstream& in, size_t block_size = DEFAULT_BLOCK_SIZE);
+    explicit BitReader(ByteSource& source, size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    BitReader(const BitReader&) = delete;
+    BitReader& operator=(const BitReader&) = delete;
+
+    // ȡָλĴ루1-32 λ
+    bool read(uint32_t& code, int width) {
+        if (width <= 0 || width > 32) return false;
+
+        if (acc_bits_ < width) {
+            refill();
+            if (acc_bits_ < width) return false;
+        }
+        code = peek(width);
+        consume(width);
+        return true;
+    }
+
+    // 鿴ۼ width λģǰ豣֤ available() >= width
+    uint32_t peek(int width) const {
+        return static_cast<uint32_t>(acc_ & ((uint64_t(1) << width) - 1));
+    }
+
+    //  width λ
+    void consume(int width) {
+        acc_ >>= width;
+        acc_bits_ -= width;
+        bits_read_ += width;
+    }
+
+    // ۼ 57 λ벻ʱ
+    void refill();
+
+    // ۼеЧλ
+    int available() const { return acc_bits_; }
 
     // Ƿݿɶ
     bool hasMore() const;
@@ -41,15 +124,22 @@ public:
     // ȡѶȡλ
     uint64_t getBitsRead() const { return bits_read_; }
 
+    // һֽڱ߽λ size ֽڣڶȡ֮βݲʱ false
+    bool readAlignedBytes(uint8_t* buf, size_t size);
+
 private:
-    std::ifstream& in_;
-    uint32_t buffer_;       // λ
-    int buffer_bits_;       // еЧλ
-    uint64_t bits_read_;    // ܶȡλ
-    bool eof_reached_;      // Ƿ񵽴ļĩβ
-
-    // 仺
-    bool fillBuffer();
+    std::unique_ptr<ByteSource> owned_source_;
+    ByteSource* source_;
+    std::vector<uint8_t> block_; // 
+    size_t pos_;                 // һδصֽ
+    size_t end_;                 // Чݵĩβ
+    uint64_t acc_;               // λۼ
+    int acc_bits_;               // ۼеЧλ
+    uint64_t bits_read_;         // ܶȡλ
+    bool eof_reached_;           // ǷѶ
+
+    // ʣֽƵײ˶
+    void fillBlock();
 };
 
 #endif
\ No newline at end of file
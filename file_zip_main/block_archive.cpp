@@ -0,0 +1,403 @@
+#include "block_archive.h"
+#include "bitio.h"
+#include "lzw_decompress.h"
+#include "columnar.h"
+#include "multi_archive.h"
+#include "trace.h"
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+
+bool blockTableValid(const ArchiveHeader& header, const std::vector<BlockEntry>& table) {
+    if (header.block_size == 0) return header.block_count == 0 && header.original_size == 0;
+    if (header.block_count != blockCountFor(header.original_size, header.block_size)) return false;
+    if (table.size() != header.block_count) return false;
+
+    uint64_t total = 0;
+    for (const auto& e : table) {
+        if (e.original_size > header.block_size) return false;
+        total += e.original_size;
+    }
+    return total == header.original_size;
+}
+
+bool readArchiveLayout(BufferedFileReader& in, ArchiveLayout& layout) {
+    ArchiveHeader& header = layout.header;
+    if (!readHeader(in, header)) {
+        std::cerr << "Error: failed to read header\n";
+        return false;
+    }
+
+    if (!headerMagicOk(header)) {
+        std::cerr << "Error: invalid file format\n";
+        return false;
+    }
+
+    if (header.version < ArchiveHeader::VERSION_STREAM || header.version > ArchiveHeader::VERSION_MULTI) {
+        std::cerr << "Error: unsupported archive version " << int(header.version) << "\n";
+        return false;
+    }
+
+    if (header.max_code_width < ArchiveHeader::MIN_CODE_WIDTH || header.max_code_width > ArchiveHeader::MAX_CODE_WIDTH) {
+        std::cerr << "Error: unsupported max code width " << header.max_code_width << "\n";
+        return false;
+    }
+
+    // 大小未知（带尾部）的只有流式写出的单一码流与列式归档
+    if (header.sizeUnknown() && (header.isBlocked() || header.isMulti() || header.original_size != 0)) {
+        std::cerr << "Error: invalid header flags\n";
+        return false;
+    }
+
+    // 读取预处理表（如果存在）
+    if (header.hasPreprocessing()) {
+        if (!layout.preprocessing.deserialize_table(in)) {
+            std::cerr << "Error: failed to read preprocessing table\n";
+            return false;
+        }
+    }
+
+    // 读取块表（分块格式）
+    layout.blocks.clear();
+    if (header.isBlocked()) {
+        // 解码时每个线程按 block_size 分配缓冲区，不能直接信任归档中的值
+        bool valid = header.block_size > 0 && header.block_size <= ArchiveHeader::MAX_BLOCK_SIZE
+            && header.block_count == blockCountFor(header.original_size, header.block_size)
+            && readBlockTable(in, header.block_count, layout.blocks)
+            && blockTableValid(header, layout.blocks);
+        // 压缩大小同样决定读缓冲区的大小：普通文件中各块合计不能超出文件的剩余部分
+        if (valid && in.sizeKnown()) {
+            uint64_t total = 0;
+            for (const auto& e : layout.blocks) total += e.compressed_size;
+            valid = in.position() <= in.fileSize() && total <= in.fileSize() - in.position();
+        }
+        if (!valid) {
+            std::cerr << "Error: invalid block table\n";
+            return false;
+        }
+    }
+
+    // 列式格式的段大小上限与 --block-size 的取值范围一致
+    if (header.isColumnar() && (header.block_size == 0 || header.block_size > ArchiveHeader::MAX_BLOCK_SIZE)) {
+        std::cerr << "Error: invalid chunk size " << header.block_size << "\n";
+        return false;
+    }
+
+    // 读取成员目录（多文件归档）
+    layout.members.clear();
+    if (header.isMulti()) {
+        if (!in.sizeKnown()) {
+            std::cerr << "Error: a multi-file archive must be read from a regular file, not a pipe\n";
+            return false;
+        }
+        bool valid = !header.hasPreprocessing()
+            && readMemberDirectory(in, header.block_count, layout.members)
+            && memberDirectoryValid(header, layout.members, in.position(), in.fileSize());
+        if (!valid) {
+            std::cerr << "Error: invalid member directory\n";
+            return false;
+        }
+    }
+
+    layout.data_offset = in.position();
+    return true;
+}
+
+BlockIndex::BlockIndex(uint64_t data_offset, const std::vector<BlockEntry>& table)
+    : archive_offsets(table.size()), original_offsets(table.size()) {
+    uint64_t src = data_offset;
+    uint64_t dst = 0;
+    for (size_t i = 0; i < table.size(); ++i) {
+        archive_offsets[i] = src;
+        original_offsets[i] = dst;
+        src += table[i].compressed_size;
+        dst += table[i].original_size;
+    }
+}
+
+size_t BlockIndex::blockAt(uint64_t offset) const {
+    auto it = std::upper_bound(original_offsets.begin(), original_offsets.end(), offset);
+    return static_cast<size_t>(it - original_offsets.begin()) - 1;
+}
+
+bool RangeByteSink::write(const uint8_t* data, size_t size) {
+    if (skip_ >= size) {
+        skip_ -= size;
+        return true;
+    }
+    data += skip_;
+    size -= static_cast<size_t>(skip_);
+    skip_ = 0;
+
+    size_t n = static_cast<size_t>(std::min<uint64_t>(size, remaining_));
+    if (n > 0 && !downstream_.write(data, n)) return false;
+    remaining_ -= n;
+    // 区间已写满：返回 false 让上游停止解码（调用方用 done() 区分）
+    return remaining_ > 0;
+}
+
+bool compressOneBlock(const uint8_t* data, size_t size, const LZWCompressOptions& options,
+    std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(size / 2 + 64);
+    MemoryByteSink sink(out);
+    BitWriter writer(sink);
+    LZWCompressor compressor(options);
+    if (!compressor.compressBuffer(data, size, writer)) return false;
+    return writer.flush();
+}
+
+bool compressBlocks(const uint8_t* data, uint64_t size, const BlockCompressOptions& options,
+    ByteSink& out, std::vector<BlockEntry>& table) {
+    const uint32_t count = blockCountFor(size, options.block_size);
+    const int threads = std::max(1, options.threads);
+    // 同时在途（已领取但尚未写出）的块数上限
+    const uint32_t window = static_cast<uint32_t>(threads) * 2;
+
+    table.assign(count, BlockEntry{ 0, 0 });
+    std::vector<std::vector<uint8_t>> results(count);
+    std::vector<char> ready(count, 0);
+    uint32_t next_block = 0;   // 下一个待领取的块
+    uint32_t written = 0;      // 已写出的块数
+    bool failed = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    auto worker = [&]() {
+        traceThreadName("block worker");
+        std::vector<uint8_t> buffer;
+        for (;;) {
+            uint32_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return failed || next_block >= count || next_block < written + window; });
+                if (failed || next_block >= count) return;
+                index = next_block++;
+            }
+
+            uint64_t offset = uint64_t(index) * options.block_size;
+            size_t block_len = static_cast<size_t>(std::min<uint64_t>(options.block_size, size - offset));
+            TraceScope trace("compressBlock", "task");
+            trace.setBytes(block_len);
+            bool ok = compressOneBlock(data + offset, block_len, options.lzw, buffer);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok) {
+                failed = true;
+            }
+            else {
+                table[index].original_size = static_cast<uint32_t>(block_len);
+                table[index].compressed_size = static_cast<uint32_t>(buffer.size());
+                results[index].swap(buffer);
+                ready[index] = 1;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+
+    // 主线程按顺序写出已完成的块
+    bool ok = true;
+    for (uint32_t i = 0; i < count && ok; ++i) {
+        std::vector<uint8_t> block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return failed || ready[i]; });
+            if (failed) {
+                ok = false;
+                break;
+            }
+            block.swap(results[i]);
+        }
+
+        ok = out.write(block.data(), block.size());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        written++;
+        if (!ok) failed = true;
+        cv.notify_all();
+    }
+
+    for (auto& t : pool) {
+        t.join();
+    }
+    return ok && !failed;
+}
+
+bool decompressBlocks(ByteSource& in, const ArchiveHeader& header,
+    const std::vector<BlockEntry>& table, ByteSink& out) {
+    std::vector<uint8_t> compressed;
+    LZWDecompressor decompressor(LZWDecompressOptions(ArchiveHeader::MIN_CODE_WIDTH, header.max_code_width));
+
+    for (size_t i = 0; i < table.size(); ++i) {
+        compressed.resize(table[i].compressed_size);
+        if (!readExact(in, compressed.data(), compressed.size())) {
+            std::cerr << "Error: block " << i << " is truncated\n";
+            return false;
+        }
+
+        MemoryByteSource source(compressed.data(), compressed.size());
+        BitReader reader(source);
+        if (!decompressor.decompressStream(reader, out)) return false;
+        if (decompressor.getOutputSize() != table[i].original_size) {
+            std::cerr << "Error: block " << i << " size mismatch\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool decompressBlocksParallel(BufferedFileReader& in, uint64_t data_offset, const ArchiveHeader& header,
+    const std::vector<BlockEntry>& table, BufferedFileWriter& out, int threads) {
+    // 预先计算每块在归档中和输出中的偏移
+    BlockIndex index(data_offset, table);
+
+    std::atomic<size_t> next_block(0);
+    std::atomic<bool> failed(false);
+
+    auto worker = [&]() {
+        traceThreadName("block worker");
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> decoded(header.block_size);
+        LZWDecompressor decompressor(LZWDecompressOptions(ArchiveHeader::MIN_CODE_WIDTH, header.max_code_width));
+
+        for (;;) {
+            size_t i = next_block.fetch_add(1);
+            if (i >= table.size() || failed) return;
+
+            TraceScope trace("decompressBlock", "task");
+            trace.setBytes(table[i].original_size);
+            compressed.resize(table[i].compressed_size);
+            if (!in.readAt(index.archive_offsets[i], compressed.data(), compressed.size())) {
+                std::cerr << "Error: block " << i << " is truncated\n";
+                failed = true;
+                return;
+            }
+
+            MemoryByteSource source(compressed.data(), compressed.size());
+            BitReader reader(source);
+            SliceByteSink slice(decoded.data(), table[i].original_size);
+            if (!decompressor.decompressStream(reader, slice) || slice.size() != table[i].original_size) {
+                std::cerr << "Error: block " << i << " failed to decode\n";
+                failed = true;
+                return;
+            }
+
+            if (!out.writeAt(index.original_offsets[i], decoded.data(), slice.size())) {
+                std::cerr << "Error: failed to write block " << i << "\n";
+                failed = true;
+                return;
+            }
+        }
+    };
+
+    int count = std::max(1, std::min<int>(threads, static_cast<int>(table.size())));
+    std::vector<std::thread> pool;
+    for (int i = 0; i < count; ++i) {
+        pool.emplace_back(worker);
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    return !failed;
+}
+
+bool extractRange(const std::string& archive_path, uint64_t offset, uint64_t length, ByteSink& out,
+    FileBackend backend) {
+    BufferedFileReader in;
+    if (!in.open(archive_path, BufferedFileReader::DEFAULT_BUFFER_SIZE, backend)) {
+        std::cerr << "Error: cannot open compressed file for reading\n";
+        return false;
+    }
+
+    ArchiveLayout layout;
+    if (!readArchiveLayout(in, layout)) return false;
+    const ArchiveHeader& header = layout.header;
+
+    if (header.isMulti()) {
+        std::cerr << "Error: --offset/--length need a single-file archive, use --member for multi-file archives\n";
+        return false;
+    }
+
+    // 大小未知的归档只能解码到码流结束才知道区间是否越界
+    if (!header.sizeUnknown()) {
+        if (offset > header.original_size) {
+            std::cerr << "Error: offset " << offset << " is past the end of the data (" << header.original_size << " bytes)\n";
+            return false;
+        }
+        length = std::min(length, header.original_size - offset);
+        if (length == 0) return true;
+    }
+
+    LZWDecompressor decompressor(LZWDecompressOptions(ArchiveHeader::MIN_CODE_WIDTH, header.max_code_width));
+
+    if (!header.isBlocked() || header.hasPreprocessing() || !in.sizeKnown()) {
+        // 没有可用的块索引（单一码流、预处理或列式）或归档来自管道：从头解码，只转发区间内的字节
+        RangeByteSink range(out, offset, length);
+        restore_sink restorer(layout.preprocessing, range);
+        ByteSink& sink = header.hasPreprocessing() ? static_cast<ByteSink&>(restorer) : range;
+        bool ok;
+        if (header.isColumnar()) {
+            ok = decompressColumnar(in, header, sink);
+        }
+        else if (header.isBlocked()) {
+            ok = decompressBlocks(in, header, layout.blocks, sink);
+        }
+        else {
+            BitReader reader(in);
+            ok = decompressor.decompressStream(reader, sink);
+        }
+        if (ok && header.hasPreprocessing()) {
+            restorer.finish();
+        }
+        // 大小未知时区间可以越过数据末尾，码流完整解码即可
+        if (!range.done() && !(ok && header.sizeUnknown())) {
+            std::cerr << "Error: LZW decompression failed\n";
+            return false;
+        }
+        return true;
+    }
+
+    // 分块归档：定位到第一个重叠块，只解码与区间重叠的块
+    BlockIndex index(layout.data_offset, layout.blocks);
+    size_t first = index.blockAt(offset);
+    size_t last = index.blockAt(offset + length - 1);
+
+    // 解码缓冲区按实际要解码的块分配，不按 header 中的 block_size
+    uint32_t largest = 0;
+    for (size_t i = first; i <= last; ++i) {
+        largest = std::max(largest, layout.blocks[i].original_size);
+    }
+    std::vector<uint8_t> compressed;
+    std::vector<uint8_t> decoded(largest);
+    for (size_t i = first; i <= last; ++i) {
+        const BlockEntry& entry = layout.blocks[i];
+        compressed.resize(entry.compressed_size);
+        if (!in.readAt(index.archive_offsets[i], compressed.data(), compressed.size())) {
+            std::cerr << "Error: block " << i << " is truncated\n";
+            return false;
+        }
+
+        MemoryByteSource source(compressed.data(), compressed.size());
+        BitReader reader(source);
+        SliceByteSink slice(decoded.data(), entry.original_size);
+        if (!decompressor.decompressStream(reader, slice) || slice.size() != entry.original_size) {
+            std::cerr << "Error: block " << i << " failed to decode\n";
+            return false;
+        }
+
+        // 截取本块与区间重叠的部分
+        uint64_t block_begin = index.original_offsets[i];
+        uint64_t begin = std::max(offset, block_begin) - block_begin;
+        uint64_t end = std::min(offset + length, block_begin + entry.original_size) - block_begin;
+        if (!out.write(decoded.data() + begin, static_cast<size_t>(end - begin))) return false;
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef BLOCK_ARCHIVE_H
+#define BLOCK_ARCHIVE_H
+
+#include <cstdint>
+#include <vector>
+#include "format.h"
+#include "fileio.h"
+#include "lzw_compress.h"
+#include "preprocess.h"
+
+// 分块压缩参数
+struct BlockCompressOptions {
+    LZWCompressOptions lzw;
+    uint32_t block_size = 8 * 1024 * 1024;  // 每块原始大小
+    int threads = 1;                        // 工作线程数
+};
+
+// 计算 size 字节按 block_size 分块后的块数
+inline uint32_t blockCountFor(uint64_t size, uint32_t block_size) {
+    return static_cast<uint32_t>((size + block_size - 1) / block_size);
+}
+
+// 检查 header 中的分块参数与块表是否自洽
+bool blockTableValid(const ArchiveHeader& header, const std::vector<BlockEntry>& table);
+
+// 归档头部区域：header、预处理表（可选）、块表（仅分块格式）、成员目录（仅多文件归档）
+struct ArchiveLayout {
+    ArchiveHeader header;
+    preprocessor preprocessing;
+    std::vector<BlockEntry> blocks;
+    std::vector<MemberEntry> members;  // 仅多文件归档
+    uint64_t data_offset = 0;       // 码流（或第一块）在归档中的偏移
+};
+
+// 从 in 的开头读取并校验头部区域，成功时 in 停在码流起点
+bool readArchiveLayout(BufferedFileReader& in, ArchiveLayout& layout);
+
+// 由块表前缀和得到的偏移索引
+struct BlockIndex {
+    std::vector<uint64_t> archive_offsets;   // 每块压缩数据在归档中的偏移
+    std::vector<uint64_t> original_offsets;  // 每块在原始数据中的偏移
+
+    BlockIndex(uint64_t data_offset, const std::vector<BlockEntry>& table);
+
+    // 返回包含原始偏移 offset 的块号（offset 需小于原始大小）
+    size_t blockAt(uint64_t offset) const;
+};
+
+// 只转发 [skip, skip + length) 区间内字节的输出端，区间写满后拒绝继续写入
+class RangeByteSink : public ByteSink {
+public:
+    RangeByteSink(ByteSink& downstream, uint64_t skip, uint64_t length)
+        : downstream_(downstream), skip_(skip), remaining_(length) {}
+
+    bool write(const uint8_t* data, size_t size) override;
+    bool flush() override { return downstream_.flush(); }
+
+    // 区间是否已全部写出
+    bool done() const { return remaining_ == 0; }
+
+private:
+    ByteSink& downstream_;
+    uint64_t skip_;
+    uint64_t remaining_;
+};
+
+// 从归档中提取原始数据的 [offset, offset + length) 写入 out
+// 分块归档只解码与区间重叠的块；单一码流只能从头解码，写满区间后立即停止
+// backend 为读取归档所用的 I/O 后端（--io）
+bool extractRange(const std::string& archive_path, uint64_t offset, uint64_t length, ByteSink& out,
+    FileBackend backend = FileBackend::Auto);
+
+// 把 data 压缩成一个独立的 LZW 码流（以 EOF_CODE 结束并补齐到字节），写入 out（原有内容清空）
+bool compressOneBlock(const uint8_t* data, size_t size, const LZWCompressOptions& options,
+    std::vector<uint8_t>& out);
+
+// 把 data 分块后在线程池上并行压缩，按块顺序写入 out（当前位置即第一块的起点）
+// 同时在途的块数有上限，内存占用与文件大小无关；table 返回每块的大小
+bool compressBlocks(const uint8_t* data, uint64_t size, const BlockCompressOptions& options,
+    ByteSink& out, std::vector<BlockEntry>& table);
+
+// 依次解压各块（in 当前位置即第一块的起点），解码结果写入 out
+bool decompressBlocks(ByteSource& in, const ArchiveHeader& header,
+    const std::vector<BlockEntry>& table, ByteSink& out);
+
+// 多线程解压：各块按块表定位，用定位读取取出压缩数据，解码到线程预分配的缓冲区，
+// 再用定位写入写到输出文件中该块的原始偏移处
+bool decompressBlocksParallel(BufferedFileReader& in, uint64_t data_offset, const ArchiveHeader& header,
+    const std::vector<BlockEntry>& table, BufferedFileWriter& out, int threads);
+
+#endif
@@ -0,0 +1,45 @@
+#include "checksum.h"
+
+// tables[0] 为普通的按字节查表，tables[k] 为某字节之后再经过 k 个零字节的结果
+struct Crc32Tables {
+    uint32_t tables[8][256];
+
+    Crc32Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            tables[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k) {
+                uint32_t prev = tables[k - 1][i];
+                tables[k][i] = tables[0][prev & 0xFF] ^ (prev >> 8);
+            }
+        }
+    }
+};
+
+static const Crc32Tables& crc32Tables() {
+    static const Crc32Tables t;
+    return t;
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size) {
+    const uint32_t (*t)[256] = crc32Tables().tables;
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t lo = crc ^ (uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24));
+        uint32_t hi = uint32_t(data[4]) | (uint32_t(data[5]) << 8) | (uint32_t(data[6]) << 16) | (uint32_t(data[7]) << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+        --size;
+    }
+    return ~crc;
+}
@@ -0,0 +1,55 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstdint>
+#include <cstddef>
+#include "fileio.h"
+
+// CRC-32（多项式 0xEDB88320，与 zlib/gzip 相同），crc 从 0 开始，可分段累加
+// 每次处理 8 字节（slicing-by-8），远快于 LZW 编解码，不会成为流式压缩的瓶颈
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size);
+
+// 透传上游数据，同时统计字节数与 CRC-32 的输入端
+class ChecksumByteSource : public ByteSource {
+public:
+    explicit ChecksumByteSource(ByteSource& upstream) : upstream_(upstream) {}
+
+    std::size_t read(uint8_t* buf, std::size_t size) override {
+        std::size_t got = upstream_.read(buf, size);
+        crc_ = crc32Update(crc_, buf, got);
+        size_ += got;
+        return got;
+    }
+
+    uint64_t size() const { return size_; }
+    uint32_t crc() const { return crc_; }
+
+private:
+    ByteSource& upstream_;
+    uint64_t size_ = 0;
+    uint32_t crc_ = 0;
+};
+
+// 透传到下游，同时统计字节数与 CRC-32 的输出端
+class ChecksumByteSink : public ByteSink {
+public:
+    explicit ChecksumByteSink(ByteSink& downstream) : downstream_(downstream) {}
+
+    bool write(const uint8_t* data, std::size_t size) override {
+        crc_ = crc32Update(crc_, data, size);
+        size_ += size;
+        return downstream_.write(data, size);
+    }
+
+    bool flush() override { return downstream_.flush(); }
+
+    uint64_t size() const { return size_; }
+    uint32_t crc() const { return crc_; }
+
+private:
+    ByteSink& downstream_;
+    uint64_t size_ = 0;
+    uint32_t crc_ = 0;
+};
+
+#endif
@@ -0,0 +1,377 @@
+#include "columnar.h"
+#include "block_archive.h"
+#include "bitio.h"
+#include "lzw_decompress.h"
+#include "field_codec.h"
+#include "stats.h"
+#include "trace.h"
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+namespace {
+
+// нṹеֽ
+enum RowType : uint8_t {
+    ROW_RECORD_CRLF = 0,  // ¼У "\r\n" β
+    ROW_RECORD_LF = 1,    // ¼У "\n" β
+    ROW_RECORD_END = 2,   // ¼Уĩûл
+    ROW_RAW = 3,          // ԭУ֮ '\n'
+    ROW_RAW_END = 4,      // ԭУĩûлУһֱĩβ
+};
+
+// ޣнṹ + ֶ
+const uint32_t MAX_STREAMS = 1 + 1024;
+
+const char FIELDS_DIRECTIVE[] = "#Fields:";
+const size_t FIELDS_DIRECTIVE_LEN = sizeof(FIELDS_DIRECTIVE) - 1;
+
+//  line  "#Fields:" ָеֶ滻 namesֶԿոָβ '\r'
+void updateFieldNames(const uint8_t* line, size_t len, std::vector<std::string>& names) {
+    if (len < FIELDS_DIRECTIVE_LEN || std::memcmp(line, FIELDS_DIRECTIVE, FIELDS_DIRECTIVE_LEN) != 0) return;
+
+    names.clear();
+    size_t start = FIELDS_DIRECTIVE_LEN;
+    for (size_t i = FIELDS_DIRECTIVE_LEN; i <= len; ++i) {
+        if (i == len || line[i] == ' ' || line[i] == '\r') {
+            if (i > start && names.size() < MAX_STREAMS - 1) {
+                names.emplace_back(reinterpret_cast<const char*>(line) + start, i - start);
+            }
+            start = i + 1;
+        }
+    }
+}
+
+//  threads ִ߳ task(0) ... task(count - 1)ȫɹʱ true
+bool runTasks(size_t count, int threads, const std::function<bool(size_t)>& task) {
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    auto worker = [&]() {
+        for (;;) {
+            size_t i = next.fetch_add(1);
+            if (i >= count || failed) return;
+            TraceScope trace("columnTask", "task");
+            if (!task(i)) failed = true;
+        }
+    };
+
+    size_t pool_size = std::min<size_t>(std::max(1, threads), count);
+    if (pool_size <= 1) {
+        worker();
+        return !failed;
+    }
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < pool_size; ++i) {
+        pool.emplace_back([&]() {
+            traceThreadName("column worker");
+            worker();
+        });
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    return !failed;
+}
+
+// һ־нṹ͸ֶڶ֮
+// codecs ظı룬ڱеһγʱֶѡ
+class ColumnSplitter {
+public:
+    void split(const uint8_t* data, size_t size, std::vector<std::vector<uint8_t>>& streams,
+        std::vector<FieldCodec>& codecs, ColumnarStats& stats) {
+        streams.resize(1);
+        streams[0].clear();
+        codecs.assign(1, FieldCodec::Text);
+
+        size_t pos = 0;
+        while (pos < size) {
+            const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(data + pos, '\n', size - pos));
+            size_t end = nl ? static_cast<size_t>(nl - data) : size;
+            const uint8_t* line = data + pos;
+            size_t len = end - pos;
+            pos = end + 1;
+
+            bool crlf = nl && len > 0 && line[len - 1] == '\r';
+            size_t body = crlf ? len - 1 : len;
+            if (isRecord(line, body)) {
+                streams[0].push_back(!nl ? ROW_RECORD_END : crlf ? ROW_RECORD_CRLF : ROW_RECORD_LF);
+                const size_t field_count = names_.size();
+                for (size_t i = streams.size(); i <= field_count; ++i) {
+                    codecs.push_back(fieldCodecFor(names_[i - 1]));
+                }
+                if (streams.size() < field_count + 1) streams.resize(field_count + 1);
+
+                // ֶԵոֵָеĿոΪе '\n'
+                size_t column = 1;
+                size_t start = 0;
+                for (size_t i = 0; i <= body; ++i) {
+                    if (i == body || line[i] == ' ') {
+                        std::vector<uint8_t>& out = streams[column++];
+                        out.insert(out.end(), line + start, line + i);
+                        out.push_back('\n');
+                        start = i + 1;
+                    }
+                }
+                stats.records++;
+            }
+            else {
+                std::vector<uint8_t>& rows = streams[0];
+                rows.push_back(nl ? ROW_RAW : ROW_RAW_END);
+                rows.insert(rows.end(), line, line + len);
+                if (nl) rows.push_back('\n');
+                updateFieldNames(line, len, names_);
+                stats.raw_lines++;
+            }
+        }
+    }
+
+private:
+    std::vector<std::string> names_;  // ǰ #Fields ֶձʾû
+
+    // ¼У '#' ͷոֶ - 1
+    bool isRecord(const uint8_t* line, size_t len) const {
+        const size_t field_count = names_.size();
+        if (field_count == 0 || len == 0 || line[0] == '#') return false;
+        size_t spaces = 0;
+        for (size_t i = 0; i < len; ++i) {
+            if (line[i] == ' ' && ++spaces >= field_count) return false;
+        }
+        return spaces == field_count - 1;
+    }
+};
+
+// нṹ͸һ־ ColumnSplitter 
+class ColumnJoiner {
+public:
+    bool join(const std::vector<std::vector<uint8_t>>& streams, std::vector<uint8_t>& out) {
+        out.clear();
+        const std::vector<uint8_t>& rows = streams[0];
+        std::vector<size_t> cursor(streams.size(), 0);
+
+        size_t pos = 0;
+        while (pos < rows.size()) {
+            uint8_t type = rows[pos++];
+            if (type == ROW_RAW || type == ROW_RAW_END) {
+                const uint8_t* begin = rows.data() + pos;
+                size_t len = rows.size() - pos;
+                if (type == ROW_RAW) {
+                    const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(begin, '\n', len));
+                    if (!nl) return false;
+                    len = static_cast<size_t>(nl - begin);
+                }
+                out.insert(out.end(), begin, begin + len);
+                if (type == ROW_RAW) out.push_back('\n');
+                pos += type == ROW_RAW ? len + 1 : len;
+                updateFieldNames(begin, len, names_);
+                continue;
+            }
+
+            const size_t field_count = names_.size();
+            if (type > ROW_RECORD_END || field_count == 0 || streams.size() < field_count + 1) return false;
+            for (size_t column = 1; column <= field_count; ++column) {
+                const std::vector<uint8_t>& values = streams[column];
+                const uint8_t* begin = values.data() + cursor[column];
+                const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(begin, '\n', values.size() - cursor[column]));
+                if (!nl) return false;
+                out.insert(out.end(), begin, nl);
+                out.push_back(column < field_count ? ' ' : '\r');
+                cursor[column] += static_cast<size_t>(nl - begin) + 1;
+            }
+            // һֶ֮ȷ '\r'β
+            if (type == ROW_RECORD_CRLF) out.push_back('\n');
+            else if (type == ROW_RECORD_LF) out.back() = '\n';
+            else out.pop_back();
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::string> names_;
+};
+
+// дһΣͷı͸
+bool writeChunk(ByteSink& out, uint32_t original_size, const std::vector<std::vector<uint8_t>>& encoded,
+    const std::vector<FieldCodec>& codecs, const std::vector<std::vector<uint8_t>>& compressed) {
+    std::vector<uint8_t> head;
+    write_le(head, original_size);
+    write_le(head, static_cast<uint32_t>(encoded.size()));
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        write_le(head, static_cast<uint32_t>(compressed[i].size()));
+        write_le(head, static_cast<uint32_t>(encoded[i].size()));
+    }
+    for (FieldCodec codec : codecs) {
+        head.push_back(static_cast<uint8_t>(codec));
+    }
+    if (!out.write(head.data(), head.size())) return false;
+    for (const auto& stream : compressed) {
+        if (!out.write(stream.data(), stream.size())) return false;
+    }
+    return true;
+}
+
+// ȡһ size ֽڵʵʶݷֲ
+// еĴС۸ʱڶȡ֮ǰͷڴ
+bool readStream(ByteSource& in, uint32_t size, std::vector<uint8_t>& out) {
+    const size_t step = 1024 * 1024;
+    out.clear();
+    while (out.size() < size) {
+        size_t filled = out.size();
+        size_t n = std::min<size_t>(step, size - filled);
+        out.resize(filled + n);
+        if (!readExact(in, out.data() + filled, n)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool compressColumnar(ByteSource& in, ByteSink& out, const ColumnarOptions& options, ColumnarStats& stats) {
+    std::vector<uint8_t> buffer(options.chunk_size);
+    size_t filled = 0;
+    bool eof = false;
+    ColumnSplitter splitter;
+    std::vector<std::vector<uint8_t>> streams;
+    std::vector<FieldCodec> codecs;
+    std::vector<std::vector<uint8_t>> encoded;
+    std::vector<std::vector<uint8_t>> compressed;
+
+    for (;;) {
+        while (!eof && filled < buffer.size()) {
+            size_t got = in.read(buffer.data() + filled, buffer.size() - filled);
+            if (got == 0) eof = true;
+            filled += got;
+        }
+        if (filled == 0) break;
+
+        // һ֮ʣµİһΣûлʱг
+        size_t cut = filled;
+        if (!eof) {
+            for (size_t i = filled; i > 0; --i) {
+                if (buffer[i - 1] == '\n') {
+                    cut = i;
+                    break;
+                }
+            }
+        }
+
+        // ֵ루ֱӽȥʡһοٸѹ
+        {
+            StageScope scope(Stage::Preprocess);
+            TraceScope trace("splitColumns", "preprocess");
+            trace.setBytes(cut);
+            splitter.split(buffer.data(), cut, streams, codecs, stats);
+            scope.addBytes(cut, 0);
+        }
+        encoded.resize(streams.size());
+        compressed.resize(streams.size());
+        bool ok = runTasks(streams.size(), options.threads, [&](size_t i) {
+            if (codecs[i] == FieldCodec::Text) {
+                encoded[i].swap(streams[i]);
+            }
+            else {
+                StageScope scope(Stage::Preprocess);
+                encodeColumn(codecs[i], streams[i], encoded[i]);
+            }
+            return compressOneBlock(encoded[i].data(), encoded[i].size(), options.lzw, compressed[i]);
+        });
+        if (!ok || !writeChunk(out, static_cast<uint32_t>(cut), encoded, codecs, compressed)) return false;
+
+        for (const auto& stream : encoded) {
+            stats.encoded_size += stream.size();
+        }
+
+        stats.input_size += cut;
+        stats.chunks++;
+        std::memmove(buffer.data(), buffer.data() + cut, filled - cut);
+        filled -= cut;
+    }
+
+    // 
+    std::vector<uint8_t> end;
+    write_le(end, uint32_t(0));
+    write_le(end, uint32_t(0));
+    return out.write(end.data(), end.size());
+}
+
+bool decompressColumnar(ByteSource& in, const ArchiveHeader& header, ByteSink& out, int threads) {
+    //  LZW 뼰ֵĴСޣнṹÿжһֽڣתֵһֽ
+    const uint64_t max_stream_size = uint64_t(header.block_size) * 2 + 16;
+
+    ColumnJoiner joiner;
+    std::vector<BlockEntry> table;
+    std::vector<uint8_t> codecs;
+    std::vector<std::vector<uint8_t>> compressed;
+    std::vector<std::vector<uint8_t>> encoded;
+    std::vector<std::vector<uint8_t>> streams;
+    std::vector<uint8_t> rows;
+
+    for (uint32_t chunk = 0;; ++chunk) {
+        uint32_t original_size, count;
+        if (!read_le(in, original_size) || !read_le(in, count)) {
+            std::cerr << "Error: chunk " << chunk << " is truncated\n";
+            return false;
+        }
+        if (original_size == 0 && count == 0) return true;
+        codecs.resize(count);
+        bool valid = original_size <= header.block_size && count > 0 && count <= MAX_STREAMS
+            && readBlockTable(in, count, table) && readExact(in, codecs.data(), codecs.size());
+        // һڸĺϼԭʼСÿֻлʱнṹΪ 2 ֽ/У
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < count && valid; ++i) {
+            total += table[i].original_size;
+            valid = codecs[i] < FIELD_CODEC_COUNT && table[i].original_size <= max_stream_size
+                && total <= uint64_t(original_size) * 2 + 16;
+        }
+        if (!valid) {
+            std::cerr << "Error: invalid chunk header at chunk " << chunk << "\n";
+            return false;
+        }
+
+        compressed.resize(count);
+        encoded.resize(count);
+        streams.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!readStream(in, table[i].compressed_size, compressed[i])) {
+                std::cerr << "Error: chunk " << chunk << " is truncated\n";
+                return false;
+            }
+        }
+
+        bool ok = runTasks(count, threads, [&](size_t i) {
+            encoded[i].assign(table[i].original_size, 0);
+            MemoryByteSource source(compressed[i].data(), compressed[i].size());
+            BitReader reader(source);
+            SliceByteSink slice(encoded[i].data(), encoded[i].size());
+            LZWDecompressor decompressor(LZWDecompressOptions(ArchiveHeader::MIN_CODE_WIDTH, header.max_code_width));
+            if (!decompressor.decompressStream(reader, slice) || slice.size() != encoded[i].size()) return false;
+
+            FieldCodec codec = static_cast<FieldCodec>(codecs[i]);
+            if (codec == FieldCodec::Text) {
+                streams[i].swap(encoded[i]);
+                return true;
+            }
+            StageScope scope(Stage::Preprocess);
+            return decodeColumn(codec, encoded[i].data(), encoded[i].size(), static_cast<size_t>(max_stream_size), streams[i]);
+        });
+        if (!ok) {
+            std::cerr << "Error: chunk " << chunk << " failed to decode\n";
+            return false;
+        }
+
+        bool joined;
+        {
+            StageScope scope(Stage::Preprocess);
+            TraceScope trace("joinColumns", "preprocess");
+            joined = joiner.join(streams, rows);
+            scope.addBytes(0, rows.size());
+        }
+        if (!joined || rows.size() != original_size) {
+            std::cerr << "Error: chunk " << chunk << " does not match its columns\n";
+            return false;
+        }
+        if (!out.write(rows.data(), rows.size())) return false;
+    }
+}
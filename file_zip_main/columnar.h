@@ -0,0 +1,44 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <cstdint>
+#include <vector>
+#include "format.h"
+#include "fileio.h"
+#include "lzw_compress.h"
+
+// W3C 扩展日志的列式变换（version 3 归档）
+// 按最近一条 "#Fields:" 指令的字段数把记录行拆开，同一字段的值归入同一列，每列单独压缩成一个 LZW 码流。
+// 输入按行对齐分段，各段依次存放：
+//   OriginalSize: uint32_t 本段原始字节数
+//   StreamCount: uint32_t 码流数（OriginalSize 与 StreamCount 都为 0 表示结束）
+//   StreamTable: StreamCount * { uint32_t compressed_size, uint32_t original_size }
+//   StreamCodecs: StreamCount * uint8_t 各码流的值编码（FieldCodec）
+//   之后依次存放各码流
+// 码流 0 为行结构：每行一个类型字节，不是记录的行（指令、空行、字段数不符的行）原样跟在类型字节之后；
+// 码流 i（i >= 1）为第 i 个字段的值，每个值以 '\n' 结尾。time、IP、状态码等字段按字段名
+// 先做值编码（field_codec.h），表中的 original_size 是值编码之后、送入 LZW 的字节数
+
+// 列式压缩参数
+struct ColumnarOptions {
+    LZWCompressOptions lzw;
+    uint32_t chunk_size = 8 * 1024 * 1024;  // 每段原始大小的上限
+    int threads = 1;                        // 同一段内各列并行压缩的线程数
+};
+
+// 列式压缩统计
+struct ColumnarStats {
+    uint64_t input_size = 0;   // 原始字节数
+    uint64_t records = 0;      // 拆成列的记录行数
+    uint64_t raw_lines = 0;    // 原样保存的行数
+    uint64_t encoded_size = 0; // 值编码之后送入 LZW 的字节数
+    uint32_t chunks = 0;
+};
+
+// 从 in 顺序读取日志，按段拆列压缩后写入 out（当前位置即第一段的起点）
+bool compressColumnar(ByteSource& in, ByteSink& out, const ColumnarOptions& options, ColumnarStats& stats);
+
+// 依次解压各段（in 当前位置即第一段的起点）：各列在 threads 个线程上并行解码，再重组成行写入 out
+bool decompressColumnar(ByteSource& in, const ArchiveHeader& header, ByteSink& out, int threads = 1);
+
+#endif
@@ -0,0 +1,214 @@
+#include "field_codec.h"
+#include <cstring>
+
+namespace {
+
+// 转义标记：其后是原始值和 '\n'
+const uint8_t ESCAPE = 0x00;
+const uint8_t IPV4_BINARY = 0x01;
+
+// 超过 18 位的十进制数可能溢出 uint64_t，按原样保存
+const size_t MAX_INTEGER_DIGITS = 18;
+
+void writeVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+bool readVarint(const uint8_t* data, size_t size, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= size) return false;
+        uint8_t b = data[pos++];
+        v |= uint64_t(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+// 规范的十进制整数：只有数字，除 "0" 外没有前导零
+bool parseInteger(const uint8_t* s, size_t len, uint64_t& v) {
+    if (len == 0 || len > MAX_INTEGER_DIGITS || (s[0] == '0' && len > 1)) return false;
+    v = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        v = v * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+void appendInteger(std::vector<uint8_t>& out, uint64_t v) {
+    char digits[24];
+    size_t n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (n > 0) out.push_back(static_cast<uint8_t>(digits[--n]));
+}
+
+// 两位数字，不超过 limit - 1
+bool parseTwoDigits(const uint8_t* s, int limit, int& v) {
+    if (s[0] < '0' || s[0] > '9' || s[1] < '0' || s[1] > '9') return false;
+    v = (s[0] - '0') * 10 + (s[1] - '0');
+    return v < limit;
+}
+
+// "HH:MM:SS" → 当天的秒数
+bool parseTime(const uint8_t* s, size_t len, int64_t& seconds) {
+    int h, m, sec;
+    if (len != 8 || s[2] != ':' || s[5] != ':') return false;
+    if (!parseTwoDigits(s, 24, h) || !parseTwoDigits(s + 3, 60, m) || !parseTwoDigits(s + 6, 60, sec)) return false;
+    seconds = h * 3600 + m * 60 + sec;
+    return true;
+}
+
+void appendTime(std::vector<uint8_t>& out, int64_t seconds) {
+    const int parts[3] = { static_cast<int>(seconds / 3600), static_cast<int>(seconds / 60 % 60), static_cast<int>(seconds % 60) };
+    for (int i = 0; i < 3; ++i) {
+        if (i > 0) out.push_back(':');
+        out.push_back(static_cast<uint8_t>('0' + parts[i] / 10));
+        out.push_back(static_cast<uint8_t>('0' + parts[i] % 10));
+    }
+}
+
+// 规范的点分四段：每段 0-255，没有前导零
+bool parseIPv4(const uint8_t* s, size_t len, uint8_t ip[4]) {
+    size_t pos = 0;
+    for (int part = 0; part < 4; ++part) {
+        if (part > 0) {
+            if (pos >= len || s[pos] != '.') return false;
+            ++pos;
+        }
+        size_t start = pos;
+        while (pos < len && pos - start < 3 && s[pos] >= '0' && s[pos] <= '9') ++pos;
+        uint64_t v;
+        if (!parseInteger(s + start, pos - start, v) || v > 255) return false;
+        ip[part] = static_cast<uint8_t>(v);
+    }
+    return pos == len;
+}
+
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+void appendEscaped(std::vector<uint8_t>& out, const uint8_t* value, size_t len) {
+    out.push_back(ESCAPE);
+    out.insert(out.end(), value, value + len);
+    out.push_back('\n');
+}
+
+} // namespace
+
+FieldCodec fieldCodecFor(const std::string& field_name) {
+    static const char* const integers[] = {
+        "s-port", "sc-status", "sc-substatus", "sc-win32-status", "sc-bytes", "cs-bytes", "time-taken",
+    };
+    for (const char* name : integers) {
+        if (field_name == name) return FieldCodec::Integer;
+    }
+    if (field_name == "time") return FieldCodec::Time;
+    if (field_name == "s-ip" || field_name == "c-ip") return FieldCodec::IPv4;
+    return FieldCodec::Text;
+}
+
+const char* fieldCodecName(FieldCodec codec) {
+    switch (codec) {
+    case FieldCodec::Integer: return "integer";
+    case FieldCodec::Time: return "time";
+    case FieldCodec::IPv4: return "ipv4";
+    default: return "text";
+    }
+}
+
+void encodeColumn(FieldCodec codec, const std::vector<uint8_t>& values, std::vector<uint8_t>& out) {
+    out.clear();
+    if (codec == FieldCodec::Text) {
+        out = values;
+        return;
+    }
+
+    out.reserve(values.size());
+    int64_t previous_time = 0;
+    size_t pos = 0;
+    while (pos < values.size()) {
+        const uint8_t* value = values.data() + pos;
+        const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(value, '\n', values.size() - pos));
+        size_t len = nl ? static_cast<size_t>(nl - value) : values.size() - pos;
+        pos += len + 1;
+
+        uint64_t n;
+        int64_t seconds;
+        uint8_t ip[4];
+        if (codec == FieldCodec::Integer && parseInteger(value, len, n)) {
+            writeVarint(out, n + 1);
+        }
+        else if (codec == FieldCodec::Time && parseTime(value, len, seconds)) {
+            writeVarint(out, zigzag(seconds - previous_time) + 1);
+            previous_time = seconds;
+        }
+        else if (codec == FieldCodec::IPv4 && parseIPv4(value, len, ip)) {
+            out.push_back(IPV4_BINARY);
+            out.insert(out.end(), ip, ip + 4);
+        }
+        else {
+            appendEscaped(out, value, len);
+        }
+    }
+}
+
+bool decodeColumn(FieldCodec codec, const uint8_t* data, size_t size, size_t max_size, std::vector<uint8_t>& out) {
+    out.clear();
+    if (codec == FieldCodec::Text) {
+        if (size > max_size) return false;
+        out.assign(data, data + size);
+        return true;
+    }
+
+    // 时间差的绝对值不超过一天
+    const uint64_t max_time_code = zigzag(-24 * 3600) + 1;
+
+    int64_t previous_time = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        if (data[pos] == ESCAPE) {
+            const uint8_t* value = data + pos + 1;
+            const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(value, '\n', size - pos - 1));
+            if (!nl) return false;
+            out.insert(out.end(), value, nl);
+            pos = static_cast<size_t>(nl - data) + 1;
+        }
+        else if (codec == FieldCodec::IPv4) {
+            if (data[pos] != IPV4_BINARY || size - pos < 5) return false;
+            for (int i = 0; i < 4; ++i) {
+                if (i > 0) out.push_back('.');
+                appendInteger(out, data[pos + 1 + i]);
+            }
+            pos += 5;
+        }
+        else {
+            uint64_t v;
+            if (!readVarint(data, size, pos, v) || v == 0) return false;
+            if (codec == FieldCodec::Integer) {
+                appendInteger(out, v - 1);
+            }
+            else {
+                if (v > max_time_code) return false;
+                previous_time += unzigzag(v - 1);
+                if (previous_time < 0 || previous_time >= 24 * 3600) return false;
+                appendTime(out, previous_time);
+            }
+        }
+        out.push_back('\n');
+        if (out.size() > max_size) return false;
+    }
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef FIELD_CODEC_H
+#define FIELD_CODEC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 列式格式中单列的值编码：把 LZW 不擅长的数字字段换成紧凑的二进制形式再送入 LZW
+// 列的原始形式为以 '\n' 结尾的值序列；不符合规范形式的值（如 "-"、前导零）原样转义保存，编码总是可逆
+enum class FieldCodec : uint8_t {
+    Text = 0,     // 不编码
+    Integer = 1,  // 十进制整数 → varint(n + 1)
+    Time = 2,     // "HH:MM:SS" → 与上一个时间之差（秒）的 zigzag varint + 1
+    IPv4 = 3,     // 点分四段 IPv4 地址 → 0x01 + 4 字节
+};
+
+// 取值的上限（不含）
+const uint8_t FIELD_CODEC_COUNT = 4;
+
+// 按 #Fields 中的字段名选择编码
+FieldCodec fieldCodecFor(const std::string& field_name);
+
+const char* fieldCodecName(FieldCodec codec);
+
+// 编码一列，结果写入 out（原有内容清空）
+void encodeColumn(FieldCodec codec, const std::vector<uint8_t>& values, std::vector<uint8_t>& out);
+
+// 解码一列，结果写入 out（原有内容清空）；数据损坏或结果超过 max_size 字节时返回 false
+bool decodeColumn(FieldCodec codec, const uint8_t* data, size_t size, size_t max_size, std::vector<uint8_t>& out);
+
+#endif
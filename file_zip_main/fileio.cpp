@@ -1,39 +1,467 @@
 #include "fileio.h"
+#include "io_uring_queue.h"
+#include "stats.h"
+#include "trace.h"
 #include <sys/stat.h>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#define FILEIO_HAS_MMAP 1
+#endif
+
+const char* fileBackendName(FileBackend backend) {
+    switch (backend) {
+    case FileBackend::Mmap: return "mmap";
+    case FileBackend::Pread: return "pread";
+    case FileBackend::Uring: return "uring";
+    default: return "auto";
+    }
+}
+
+bool parseFileBackend(const std::string& name, FileBackend& backend) {
+    const FileBackend all[] = { FileBackend::Auto, FileBackend::Mmap, FileBackend::Pread, FileBackend::Uring };
+    for (FileBackend b : all) {
+        if (name == fileBackendName(b)) {
+            backend = b;
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef FILEIO_HAS_IO_URING
+
+// io_uring 后端：固定数量的大块缓冲槽轮流提交，同时最多 DEPTH 个请求在途
+struct UringState {
+    static const std::size_t DEPTH = 4;
+
+    enum SlotState : uint8_t { Idle, InFlight, Done };
+
+    std::vector<std::vector<uint8_t>> slots;
+    std::vector<uint64_t> offsets;       // 每个槽请求的文件偏移
+    std::vector<std::size_t> lengths;    // 每个槽请求的字节数
+    std::vector<int32_t> results;        // 完成结果（字节数或 -errno）
+    std::vector<SlotState> states;
+    std::size_t current = 0;             // 读：正在消费的槽；写：正在填充的槽
+    std::size_t next = 0;                // 读：下一个要消费的槽
+    bool consuming = false;              // 读：current 是否有效
+    uint64_t next_offset = 0;            // 下一个请求的文件偏移
+    IoUringQueue queue;                  // 最后声明、最先销毁：先停掉队列再释放缓冲区
+
+    ~UringState() { waitAll(); }
+
+    bool init(std::size_t slot_size) {
+        if (!queue.init(DEPTH * 2)) return false;
+        slots.assign(DEPTH, std::vector<uint8_t>(slot_size));
+        offsets.assign(DEPTH, 0);
+        lengths.assign(DEPTH, 0);
+        results.assign(DEPTH, 0);
+        states.assign(DEPTH, Idle);
+
+        // 注册固定缓冲区，省去每次请求时内核映射用户页；失败时使用普通读写
+        std::vector<std::pair<void*, std::size_t>> buffers;
+        for (auto& slot : slots) {
+            buffers.emplace_back(slot.data(), slot.size());
+        }
+        queue.registerBuffers(buffers);
+        return true;
+    }
+
+    bool submitRead(int fd, std::size_t slot, uint64_t offset, std::size_t len) {
+        if (!queue.prepareRead(fd, slots[slot].data(), static_cast<unsigned>(len), offset, static_cast<int>(slot), slot)
+            || !queue.submit()) {
+            return false;
+        }
+        offsets[slot] = offset;
+        lengths[slot] = len;
+        states[slot] = InFlight;
+        return true;
+    }
+
+    bool submitWrite(int fd, std::size_t slot, uint64_t offset, std::size_t len) {
+        if (!queue.prepareWrite(fd, slots[slot].data(), static_cast<unsigned>(len), offset, static_cast<int>(slot), slot)
+            || !queue.submit()) {
+            return false;
+        }
+        offsets[slot] = offset;
+        lengths[slot] = len;
+        states[slot] = InFlight;
+        return true;
+    }
+
+    // 等待 slot 上的请求完成（期间到达的其他完成事件一并记录）
+    bool wait(std::size_t slot) {
+        while (states[slot] == InFlight) {
+            uint64_t user_data;
+            int32_t result;
+            if (!queue.wait(user_data, result)) return false;
+            if (user_data < DEPTH) {
+                results[user_data] = result;
+                states[user_data] = Done;
+            }
+        }
+        return true;
+    }
+
+    bool waitAll() {
+        bool ok = true;
+        for (std::size_t i = 0; i < states.size(); ++i) {
+            ok = wait(i) && ok;
+        }
+        return ok;
+    }
+
+    // 确认 slot 上的写入已完成，短写时用 pwrite 补齐剩余部分
+    bool completeWrite(int fd, std::size_t slot) {
+        if (!wait(slot)) return false;
+        if (states[slot] == Idle) return true;
+        states[slot] = Idle;
+        if (results[slot] < 0) return false;
+
+        std::size_t done = static_cast<std::size_t>(results[slot]);
+        while (done < lengths[slot]) {
+            ssize_t put = ::pwrite(fd, slots[slot].data() + done, lengths[slot] - done,
+                static_cast<off_t>(offsets[slot] + done));
+            if (put < 0 && errno == EINTR) continue;
+            if (put <= 0) return false;
+            done += static_cast<std::size_t>(put);
+        }
+        return true;
+    }
+};
+
+#else
+
+struct UringState {
+};
+
+#endif
+
+BufferedFileReader::BufferedFileReader() = default;
 
 BufferedFileReader::~BufferedFileReader() {
     close();
 }
 
-bool BufferedFileReader::open(const std::string& path, std::size_t buffer_size) {
+std::size_t BufferedFileReader::read(uint8_t* buf, std::size_t size) {
+    StageScope stage(Stage::Read);
+    TraceScope trace("read", "io");
+    if (mapped_) {
+        std::size_t n = static_cast<std::size_t>(std::min<uint64_t>(size, file_size_ - position_));
+        if (n > 0) std::memcpy(buf, map_data_ + position_, n);
+        position_ += n;
+        stage.addBytes(n, n);
+        trace.setBytes(n);
+        return n;
+    }
+
+    std::size_t total = 0;
+    while (size > 0) {
+        if (buffer_pos_ < buffer_end_) {
+            std::size_t n = std::min(size, buffer_end_ - buffer_pos_);
+            std::memcpy(buf, buffer_data_ + buffer_pos_, n);
+            buffer_pos_ += n;
+            buf += n;
+            size -= n;
+            total += n;
+            continue;
+        }
+
+        // 大块请求绕过缓冲区直接读到调用方内存
+        if (!uring_ && size >= buffer_.size()) {
+            std::size_t got = readFile(buf, size);
+            total += got;
+            break;
+        }
+
+        if (!refill()) break;
+    }
+    position_ += total;
+    stage.addBytes(total, total);
+    trace.setBytes(total);
+    return total;
+}
+
+bool BufferedFileReader::refill() {
+    if (uring_) return refillUring();
+    buffer_data_ = buffer_.data();
+    buffer_pos_ = 0;
+    buffer_end_ = readFile(buffer_.data(), buffer_.size());
+    return buffer_end_ > 0;
+}
+
+#ifdef FILEIO_HAS_IO_URING
+
+bool BufferedFileReader::startUring(uint64_t offset) {
+    UringState& u = *uring_;
+    if (!u.waitAll()) return false;
+    std::fill(u.states.begin(), u.states.end(), UringState::Idle);
+    u.next = 0;
+    u.consuming = false;
+    u.next_offset = offset;
+    buffer_pos_ = buffer_end_ = 0;
+
+    // 一开始就把所有槽的读请求都提交出去
+    for (std::size_t i = 0; i < UringState::DEPTH && u.next_offset < file_size_; ++i) {
+        std::size_t len = static_cast<std::size_t>(std::min<uint64_t>(u.slots[i].size(), file_size_ - u.next_offset));
+        if (!u.submitRead(fd_, i, u.next_offset, len)) return false;
+        u.next_offset += len;
+    }
+    return true;
+}
+
+bool BufferedFileReader::refillUring() {
+    UringState& u = *uring_;
+    // 刚读完的槽接着预读后面的数据
+    if (u.consuming) {
+        u.states[u.current] = UringState::Idle;
+        u.consuming = false;
+        if (u.next_offset < file_size_) {
+            std::size_t len = static_cast<std::size_t>(std::min<uint64_t>(u.slots[u.current].size(), file_size_ - u.next_offset));
+            if (!u.submitRead(fd_, u.current, u.next_offset, len)) {
+                failed_ = true;
+                return false;
+            }
+            u.next_offset += len;
+        }
+    }
+
+    std::size_t slot = u.next;
+    if (u.states[slot] == UringState::Idle) return false;   // 已读到末尾
+    if (!u.wait(slot) || u.results[slot] < 0) {
+        failed_ = true;
+        return false;
+    }
+
+    // 短读：用 pread 补齐
+    std::size_t got = static_cast<std::size_t>(u.results[slot]);
+    if (got < u.lengths[slot]) {
+        if (!readAt(u.offsets[slot] + got, u.slots[slot].data() + got, u.lengths[slot] - got)) {
+            failed_ = true;
+            return false;
+        }
+        got = u.lengths[slot];
+    }
+
+    u.current = slot;
+    u.consuming = true;
+    u.next = (slot + 1) % UringState::DEPTH;
+    buffer_data_ = u.slots[slot].data();
+    buffer_pos_ = 0;
+    buffer_end_ = got;
+    return got > 0;
+}
+
+#else
+
+bool BufferedFileReader::startUring(uint64_t offset) {
+    (void)offset;
+    return false;
+}
+
+bool BufferedFileReader::refillUring() {
+    return false;
+}
+
+#endif
+
+std::size_t BufferedFileReader::readChunk(char* buf, std::size_t size) {
+    return read(reinterpret_cast<uint8_t*>(buf), size);
+}
+
+uint64_t BufferedFileReader::fileSize() const {
+    return file_size_;
+}
+
+#ifdef FILEIO_HAS_MMAP
+
+bool BufferedFileReader::open(const std::string& path, std::size_t buffer_size, FileBackend backend) {
     close();
+    // 复制标准输入的描述符，close 时不会关掉进程的 0 号描述符
+    fd_ = isStandardStream(path) ? ::dup(STDIN_FILENO) : ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+
+    struct stat st;
+    bool regular = fstat(fd_, &st) == 0 && S_ISREG(st.st_mode);
+    if (regular) {
+        file_size_ = static_cast<uint64_t>(st.st_size);
+        size_known_ = true;
+#ifdef POSIX_FADV_SEQUENTIAL
+        // 提示内核按顺序访问，加大预读窗口
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+
+    if ((backend == FileBackend::Auto || backend == FileBackend::Mmap) && regular) {
+        if (file_size_ == 0) {
+            mapped_ = true;
+        }
+        else {
+            void* p = mmap(nullptr, static_cast<size_t>(file_size_), PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, static_cast<size_t>(file_size_), MADV_SEQUENTIAL);
+                map_data_ = static_cast<const uint8_t*>(p);
+                mapped_ = true;
+            }
+        }
+    }
+
+    if (backend == FileBackend::Mmap && !mapped_) {
+        close();
+        return false;
+    }
+
+    buffer_size = std::max<std::size_t>(buffer_size, 4096);
+    if (backend == FileBackend::Uring && regular) {
+        uring_.reset(new UringState());
+        if (!uring_->init(buffer_size) || !startUring(0)) {
+            uring_.reset();
+        }
+    }
+
+    backend_ = mapped_ ? FileBackend::Mmap : uring_ ? FileBackend::Uring : FileBackend::Pread;
+    if (!mapped_ && !uring_) {
+        buffer_.resize(buffer_size);
+    }
+    return true;
+}
+
+std::size_t BufferedFileReader::readFile(uint8_t* buf, std::size_t size) {
+    for (;;) {
+        ssize_t got = ::read(fd_, buf, size);
+        if (got >= 0) return static_cast<std::size_t>(got);
+        if (errno != EINTR) {
+            failed_ = true;
+            return 0;
+        }
+    }
+}
+
+bool BufferedFileReader::readAt(uint64_t offset, void* buf, std::size_t size) {
+    StageScope stage(Stage::Read);
+    TraceScope trace("readAt", "io");
+    stage.addBytes(size, size);
+    trace.setBytes(size);
+    if (mapped_) {
+        if (offset > file_size_ || size > file_size_ - offset) return false;
+        if (size > 0) std::memcpy(buf, map_data_ + offset, size);
+        return true;
+    }
+
+    char* p = static_cast<char*>(buf);
+    while (size > 0) {
+        ssize_t got = ::pread(fd_, p, size, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        offset += static_cast<uint64_t>(got);
+        size -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+bool BufferedFileReader::seek(uint64_t offset) {
+    if (mapped_) {
+        if (offset > file_size_) return false;
+        position_ = offset;
+        return true;
+    }
+    if (uring_) {
+        if (offset > file_size_ || !startUring(offset)) return false;
+    }
+    else if (::lseek(fd_, static_cast<off_t>(offset), SEEK_SET) < 0) {
+        return false;
+    }
+    buffer_pos_ = buffer_end_ = 0;
+    position_ = offset;
+    return true;
+}
+
+void BufferedFileReader::close() {
+    uring_.reset();
+    if (map_data_) {
+        munmap(const_cast<uint8_t*>(map_data_), static_cast<size_t>(file_size_));
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    map_data_ = nullptr;
+    mapped_ = false;
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    buffer_pos_ = buffer_end_ = 0;
+    position_ = 0;
+    file_size_ = 0;
+    size_known_ = false;
+    failed_ = false;
+}
+
+bool BufferedFileReader::isOpen() const {
+    return fd_ >= 0;
+}
+
+#else
+
+bool BufferedFileReader::open(const std::string& path, std::size_t buffer_size, FileBackend backend) {
+    close();
+    // 没有 mmap 时只能使用缓冲读取
+    if (backend == FileBackend::Mmap || isStandardStream(path)) return false;
+
     in_.open(path, std::ios::in | std::ios::binary);
     if (!in_) return false;
-    buffer_size_ = buffer_size;
-    buffer_.resize(buffer_size_ ? buffer_size_ : 1);
-    // ļСseek
+    buffer_.resize(std::max<std::size_t>(buffer_size, 4096));
+    // 尝试求文件大小（seek）
     in_.seekg(0, std::ios::end);
     std::streamoff endpos = in_.tellg();
     if (endpos >= 0) {
         file_size_ = static_cast<uint64_t>(endpos);
+        size_known_ = true;
     }
-    else {
-        file_size_ = 0;
-    }
+    in_.clear();
     in_.seekg(0, std::ios::beg);
+    backend_ = FileBackend::Pread;
     return true;
 }
 
-std::size_t BufferedFileReader::readChunk(char* buf, std::size_t size) {
+std::size_t BufferedFileReader::readFile(uint8_t* buf, std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (!in_) return 0;
-    in_.read(buf, static_cast<std::streamsize>(size));
+    in_.read(reinterpret_cast<char*>(buf), static_cast<std::streamsize>(size));
+    if (in_.bad()) failed_ = true;
     std::streamsize got = in_.gcount();
-    if (got <= 0) return 0;
-    return static_cast<std::size_t>(got);
+    return got > 0 ? static_cast<std::size_t>(got) : 0;
 }
 
-uint64_t BufferedFileReader::fileSize() const {
-    return file_size_;
+bool BufferedFileReader::readAt(uint64_t offset, void* buf, std::size_t size) {
+    StageScope stage(Stage::Read);
+    TraceScope trace("readAt", "io");
+    stage.addBytes(size, size);
+    trace.setBytes(size);
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 定位读取后恢复顺序读取位置
+    in_.clear();
+    std::streamoff saved = in_.tellg();
+    in_.seekg(static_cast<std::streamoff>(offset));
+    in_.read(static_cast<char*>(buf), static_cast<std::streamsize>(size));
+    bool ok = static_cast<std::size_t>(in_.gcount()) == size;
+    in_.clear();
+    in_.seekg(saved);
+    return ok;
+}
+
+bool BufferedFileReader::seek(uint64_t offset) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_.clear();
+    in_.seekg(static_cast<std::streamoff>(offset));
+    if (!in_) return false;
+    buffer_pos_ = buffer_end_ = 0;
+    position_ = offset;
+    return true;
 }
 
 void BufferedFileReader::close() {
@@ -42,32 +470,279 @@ void BufferedFileReader::close() {
     }
     buffer_.clear();
     buffer_.shrink_to_fit();
+    buffer_pos_ = buffer_end_ = 0;
+    position_ = 0;
+    file_size_ = 0;
+    size_known_ = false;
+    failed_ = false;
 }
 
+bool BufferedFileReader::isOpen() const {
+    return in_.is_open();
+}
+
+#endif
+
+BufferedFileWriter::BufferedFileWriter() = default;
+
 BufferedFileWriter::~BufferedFileWriter() {
     close();
 }
 
-bool BufferedFileWriter::open(const std::string& path, std::size_t buffer_size) {
-    close();
-    out_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
-    if (!out_) return false;
-    buffer_size_ = buffer_size;
-    buffer_.resize(buffer_size_ ? buffer_size_ : 1);
+bool BufferedFileWriter::write(const uint8_t* data, std::size_t size) {
+    StageScope stage(Stage::Write);
+    TraceScope trace("write", "io");
+    stage.addBytes(size, size);
+    trace.setBytes(size);
+    if (failed_) return false;
+    if (!uring_ && buffer_used_ + size > buffer_cap_) {
+        if (!emitBuffer()) return false;
+        // 大块数据直接写出，不经过缓冲区
+        if (size >= buffer_cap_) {
+            position_ += size;
+            return writeFile(data, size);
+        }
+    }
+    while (size > 0) {
+        std::size_t n = std::min(size, buffer_cap_ - buffer_used_);
+        std::memcpy(buffer_data_ + buffer_used_, data, n);
+        buffer_used_ += n;
+        position_ += n;
+        data += n;
+        size -= n;
+        if (buffer_used_ == buffer_cap_ && !emitBuffer()) return false;
+    }
     return true;
 }
 
+bool BufferedFileWriter::flush() {
+    StageScope stage(Stage::Write);
+    TraceScope trace("flush", "io");
+    emitBuffer();
+#ifdef FILEIO_HAS_IO_URING
+    if (uring_) {
+        // 等所有在途的写入完成，之后 seek/setSize/close 看到的都是完整文件
+        for (std::size_t i = 0; i < UringState::DEPTH; ++i) {
+            if (!uring_->completeWrite(fd_, i)) failed_ = true;
+        }
+    }
+#endif
+    return !failed_;
+}
+
+bool BufferedFileWriter::emitBuffer() {
+    if (buffer_used_ == 0) return !failed_;
+#ifdef FILEIO_HAS_IO_URING
+    if (uring_) {
+        UringState& u = *uring_;
+        if (!u.submitWrite(fd_, u.current, u.next_offset, buffer_used_)) {
+            failed_ = true;
+            return false;
+        }
+        u.next_offset += buffer_used_;
+        buffer_used_ = 0;
+
+        // 换到下一个槽，它上一次提交的写入须先完成
+        u.current = (u.current + 1) % UringState::DEPTH;
+        if (!u.completeWrite(fd_, u.current)) {
+            failed_ = true;
+            return false;
+        }
+        buffer_data_ = u.slots[u.current].data();
+        return true;
+    }
+#endif
+    writeFile(buffer_data_, buffer_used_);
+    buffer_used_ = 0;
+    return !failed_;
+}
+
 bool BufferedFileWriter::writeChunk(const char* buf, std::size_t size) {
+    return write(reinterpret_cast<const uint8_t*>(buf), size);
+}
+
+#ifdef FILEIO_HAS_MMAP
+
+bool BufferedFileWriter::open(const std::string& path, std::size_t buffer_size, FileBackend backend) {
+    close();
+    bool standard = isStandardStream(path);
+    fd_ = standard ? ::dup(STDOUT_FILENO) : ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) return false;
+    failed_ = false;
+    buffer_size = std::max<std::size_t>(buffer_size, 4096);
+
+    // io_uring 按偏移写入，标准输出（可能是管道）只能顺序 write
+    if (backend == FileBackend::Uring && !standard) {
+        uring_.reset(new UringState());
+        if (!uring_->init(buffer_size)) {
+            uring_.reset();
+        }
+    }
+
+    if (uring_) {
+#ifdef FILEIO_HAS_IO_URING
+        buffer_data_ = uring_->slots[0].data();
+#endif
+    }
+    else {
+        buffer_.resize(buffer_size);
+        buffer_data_ = buffer_.data();
+    }
+    buffer_cap_ = buffer_size;
+    backend_ = uring_ ? FileBackend::Uring : FileBackend::Pread;
+    return true;
+}
+
+bool BufferedFileWriter::writeFile(const uint8_t* data, std::size_t size) {
+    while (size > 0 && !failed_) {
+        ssize_t put = ::write(fd_, data, size);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) {
+            failed_ = true;
+            break;
+        }
+        data += put;
+        size -= static_cast<std::size_t>(put);
+    }
+    return !failed_;
+}
+
+bool BufferedFileWriter::writeAt(uint64_t offset, const void* buf, std::size_t size) {
+    StageScope stage(Stage::Write);
+    TraceScope trace("writeAt", "io");
+    stage.addBytes(size, size);
+    trace.setBytes(size);
+    const char* p = static_cast<const char*>(buf);
+    while (size > 0) {
+        ssize_t put = ::pwrite(fd_, p, size, static_cast<off_t>(offset));
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) return false;
+        p += put;
+        offset += static_cast<uint64_t>(put);
+        size -= static_cast<std::size_t>(put);
+    }
+    return true;
+}
+
+bool BufferedFileWriter::seek(uint64_t offset) {
+    if (!flush()) return false;
+#ifdef FILEIO_HAS_IO_URING
+    if (uring_) {
+        uring_->next_offset = offset;
+        position_ = offset;
+        return true;
+    }
+#endif
+    if (::lseek(fd_, static_cast<off_t>(offset), SEEK_SET) < 0) return false;
+    position_ = offset;
+    return true;
+}
+
+bool BufferedFileWriter::preallocate(uint64_t size) {
+    if (fd_ < 0 || size == 0) return false;
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    // 只分配块、不改变文件长度，写入失败时不会留下多余的零字节
+    return fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) == 0;
+#else
+    return false;
+#endif
+}
+
+bool BufferedFileWriter::setSize(uint64_t size) {
+    if (!flush()) return false;
+    return ::ftruncate(fd_, static_cast<off_t>(size)) == 0;
+}
+
+bool BufferedFileWriter::close() {
+    if (fd_ < 0) return !failed_;
+    bool ok = flush();
+    uring_.reset();
+    if (::close(fd_) != 0) ok = false;
+    fd_ = -1;
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    buffer_data_ = nullptr;
+    buffer_cap_ = 0;
+    buffer_used_ = 0;
+    position_ = 0;
+    return ok;
+}
+
+bool BufferedFileWriter::isOpen() const {
+    return fd_ >= 0;
+}
+
+#else
+
+bool BufferedFileWriter::open(const std::string& path, std::size_t buffer_size, FileBackend backend) {
+    close();
+    (void)backend;
+    if (isStandardStream(path)) return false;
+    out_.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
     if (!out_) return false;
-    out_.write(buf, static_cast<std::streamsize>(size));
+    buffer_.resize(std::max<std::size_t>(buffer_size, 4096));
+    buffer_data_ = buffer_.data();
+    buffer_cap_ = buffer_.size();
+    failed_ = false;
+    return true;
+}
+
+bool BufferedFileWriter::writeFile(const uint8_t* data, std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!out_.good()) failed_ = true;
+    return !failed_;
+}
+
+bool BufferedFileWriter::writeAt(uint64_t offset, const void* buf, std::size_t size) {
+    StageScope stage(Stage::Write);
+    TraceScope trace("writeAt", "io");
+    stage.addBytes(size, size);
+    trace.setBytes(size);
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.clear();
+    out_.seekp(static_cast<std::streamoff>(offset));
+    out_.write(static_cast<const char*>(buf), static_cast<std::streamsize>(size));
     return out_.good();
 }
 
-void BufferedFileWriter::close() {
-    if (out_.is_open()) {
-        out_.flush();
-        out_.close();
-    }
+bool BufferedFileWriter::seek(uint64_t offset) {
+    if (!flush()) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.seekp(static_cast<std::streamoff>(offset));
+    if (!out_) return false;
+    position_ = offset;
+    return true;
+}
+
+bool BufferedFileWriter::preallocate(uint64_t size) {
+    (void)size;
+    return false;
+}
+
+bool BufferedFileWriter::setSize(uint64_t size) {
+    // 没有 ftruncate 时在末尾写一个字节撑开文件
+    if (!flush()) return false;
+    if (size == 0) return true;
+    char zero = 0;
+    return writeAt(size - 1, &zero, 1);
+}
+
+bool BufferedFileWriter::close() {
+    if (!out_.is_open()) return !failed_;
+    bool ok = flush();
+    out_.close();
     buffer_.clear();
     buffer_.shrink_to_fit();
-}
\ No newline at end of file
+    buffer_data_ = nullptr;
+    buffer_cap_ = 0;
+    buffer_used_ = 0;
+    position_ = 0;
+    return ok;
+}
+
+bool BufferedFileWriter::isOpen() const {
+    return out_.is_open();
+}
+
+#endif
@@ -7,23 +7,23 @@
 //#include <string>
 //#include <iostream>
 //
-//// ѹļͷл/л
+//// 压缩文件头定义与序列化/反序列化工具
 //// Magic: 4 bytes, e.g. "LZWC"
 //// Version: 1 byte
 //// Flags: 1 byte (bitflags for options e.g. preprocessing)
-//// Reserved: 2 bytes (/δչ)
+//// Reserved: 2 bytes (对齐/未来扩展)
 //// OriginalSize: uint64_t (8 bytes)
-//// Extra: uint16_t initial_code_width (2 bytes) ѡֶ  д max_code_width 12
+//// Extra: uint16_t initial_code_width (2 bytes) 可选字段 —— 这里写入 max_code_width（例如 12）
 //
 //struct ArchiveHeader {
 //    std::array<char, 4> magic; // e.g. {'L','Z','W','C'}
 //    uint8_t version;          // 1
 //    uint8_t flags;            // bit flags: bit 0 = has_preprocessing
-//    uint16_t reserved;        // 
-//    uint64_t original_size;   // ԭʼļСֽڣ
-//    uint16_t max_code_width;  //  12
+//    uint16_t reserved;        // 保留对齐
+//    uint64_t original_size;   // 原始文件大小（字节）
+//    uint16_t max_code_width;  // 最大码宽（例如 12）
 //
-//    // Flag λ
+//    // Flag 位定义
 //    static const uint8_t FLAG_HAS_PREPROCESSING = 0x01;
 //
 //    ArchiveHeader() {
@@ -78,7 +78,7 @@
 //    return true;
 //}
 //
-//// д header ofstream must be opened binary
+//// 写 header 到输出流（ofstream must be opened binary）
 //inline bool writeHeader(std::ofstream& out, const ArchiveHeader& h) {
 //    if (!out) return false;
 //    // magic 4 bytes
@@ -95,7 +95,7 @@
 //    return out.good();
 //}
 //
-//// ȡ headerifstream must be opened binary
+//// 读取 header（ifstream must be opened binary）
 //inline bool readHeader(std::ifstream& in, ArchiveHeader& h) {
 //    if (!in) return false;
 //    char mag[4];
@@ -114,7 +114,7 @@
 //    return true;
 //}
 //
-//// У magic Ƿƥ
+//// 校验 magic 是否匹配
 //inline bool headerMagicOk(const ArchiveHeader& h) {
 //    return h.magic[0] == 'L' && h.magic[1] == 'Z' && h.magic[2] == 'W' && h.magic[3] == 'C';
 //}
@@ -136,27 +136,27 @@
 ////#include <string>
 ////#include <iostream>
 ////
-////// ѹļͷл/л
+////// 压缩文件头定义与序列化/反序列化工具
 ////// Magic: 4 bytes, e.g. "LZWC"
 ////// Version: 1 byte
 ////// Flags: 1 byte (bitflags for options e.g. preprocessing)
-////// Reserved: 2 bytes (/δչ)
+////// Reserved: 2 bytes (对齐/未来扩展)
 ////// OriginalSize: uint64_t (8 bytes)
-////// Extra: uint16_t initial_code_width (2 bytes) ѡֶ  д max_code_width 12
+////// Extra: uint16_t initial_code_width (2 bytes) 可选字段 —— 这里写入 max_code_width（例如 12）
 ////
 ////struct ArchiveHeader {
 ////    std::array<char,4> magic; // e.g. {'L','Z','W','C'}
 ////    uint8_t version;          // 1
 ////    uint8_t flags;            // bit flags: bit 0 = has_preprocessing
-////    uint16_t reserved;        // 
-////    uint64_t original_size;   // ԭʼļСֽڣ
-////    uint16_t max_code_width;  //  12
+////    uint16_t reserved;        // 保留对齐
+////    uint64_t original_size;   // 原始文件大小（字节）
+////    uint16_t max_code_width;  // 最大码宽（例如 12）
 ////    
-////    // Flag λ
+////    // Flag 位定义
 ////    static const uint8_t FLAG_HAS_PREPROCESSING = 0x01;
 ////    
 ////    ArchiveHeader() {
-////        magic = {'L''Z','W','C'};
+////        magic = {'L'，'Z','W','C'};
 ////        version = 1;
 ////        flags = 0;
 ////        reserved = 0;
@@ -206,11 +206,11 @@
 ////    return true;
 ////}
 ////
-////// д header ofstream must be opened binary
+////// 写 header 到输出流（ofstream must be opened binary）
 ////inline bool writeHeader(std::ofstream &out, const ArchiveHeader &h) {
 ////    if (!out) return false;
 ////    // magic 4 bytes
-////    out.write(h.magicdata(), 4);
+////    out.write(h.magic。data(), 4);
 ////    // version and flags
 ////    out.put(static_cast<char>(h.version));
 ////    out.put(static_cast<char>(h.flags));
@@ -223,7 +223,7 @@
 ////    return out.good();
 ////}
 ////
-////// ȡ headerifstream must be opened binary
+////// 读取 header（ifstream must be opened binary）
 ////inline bool readHeader(std::ifstream &in, ArchiveHeader &h) {
 ////    if (!in) return false;
 ////    char mag[4];
@@ -242,7 +242,7 @@
 ////    return true;
 ////}
 ////
-////// У magic Ƿƥ
+////// 校验 magic 是否匹配
 ////inline bool headerMagicOk(const ArchiveHeader &h) {
 ////    return h.magic[0]=='L' && h.magic[1]=='Z' && h.magic[2]=='W' && h.magic[3]=='C';
 ////}
@@ -262,51 +262,303 @@
 #include <vector>
 #include <cstdint>
 #include <iostream>
+#include <algorithm>
+#include <mutex>
+#include <memory>
 
-class BufferedFileReader {
+// 字节输出端：BitWriter 等以大块方式把数据交给它
+class ByteSink {
 public:
-    BufferedFileReader() = default;
+    virtual ~ByteSink() = default;
+
+    // 写入 size 字节，返回是否成功
+    virtual bool write(const uint8_t* data, std::size_t size) = 0;
+
+    // 把缓冲的数据交给底层设备
+    virtual bool flush() { return true; }
+};
+
+// 以 std::ostream 为后端的输出端
+class StreamByteSink : public ByteSink {
+public:
+    explicit StreamByteSink(std::ostream& out) : out_(out) {}
+
+    bool write(const uint8_t* data, std::size_t size) override {
+        out_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return out_.good();
+    }
+
+    bool flush() override {
+        out_.flush();
+        return out_.good();
+    }
+
+private:
+    std::ostream& out_;
+};
+
+// 追加到内存缓冲区的输出端
+class MemoryByteSink : public ByteSink {
+public:
+    explicit MemoryByteSink(std::vector<uint8_t>& out) : out_(out) {}
+
+    bool write(const uint8_t* data, std::size_t size) override {
+        out_.insert(out_.end(), data, data + size);
+        return true;
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+};
+
+// 字节输入端：BitReader 等按大块从中读取
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+
+    // 读取至多 size 字节，返回实际读取字节数（0 表示 EOF）
+    virtual std::size_t read(uint8_t* buf, std::size_t size) = 0;
+};
+
+// 以 std::istream 为后端的输入端
+class StreamByteSource : public ByteSource {
+public:
+    explicit StreamByteSource(std::istream& in) : in_(in) {}
+
+    std::size_t read(uint8_t* buf, std::size_t size) override {
+        if (!in_) return 0;
+        in_.read(reinterpret_cast<char*>(buf), static_cast<std::streamsize>(size));
+        std::streamsize got = in_.gcount();
+        return got > 0 ? static_cast<std::size_t>(got) : 0;
+    }
+
+private:
+    std::istream& in_;
+};
+
+// 从 in 读满 size 字节，数据不足时返回 false
+inline bool readExact(ByteSource& in, void* buf, std::size_t size) {
+    uint8_t* p = static_cast<uint8_t*>(buf);
+    while (size > 0) {
+        std::size_t got = in.read(p, size);
+        if (got == 0) return false;
+        p += got;
+        size -= got;
+    }
+    return true;
+}
+
+// 从一段连续内存读取的输入端
+class MemoryByteSource : public ByteSource {
+public:
+    MemoryByteSource(const uint8_t* data, std::size_t size) : data_(data), size_(size) {}
+
+    std::size_t read(uint8_t* buf, std::size_t size) override {
+        std::size_t n = size < size_ - pos_ ? size : size_ - pos_;
+        std::copy(data_ + pos_, data_ + pos_ + n, buf);
+        pos_ += n;
+        return n;
+    }
+
+private:
+    const uint8_t* data_;
+    std::size_t size_;
+    std::size_t pos_ = 0;
+};
+
+// 写入一段固定大小内存区间的输出端，超出容量时报错
+class SliceByteSink : public ByteSink {
+public:
+    SliceByteSink(uint8_t* data, std::size_t capacity) : data_(data), capacity_(capacity) {}
+
+    bool write(const uint8_t* data, std::size_t size) override {
+        if (size > capacity_ - size_) return false;
+        std::copy(data, data + size, data_ + size_);
+        size_ += size;
+        return true;
+    }
+
+    std::size_t size() const { return size_; }
+
+private:
+    uint8_t* data_;
+    std::size_t capacity_;
+    std::size_t size_ = 0;
+};
+
+// 文件读写后端
+enum class FileBackend {
+    Auto,    // 普通文件读取用 Mmap，其余（管道等）用 Pread
+    Mmap,    // 整个文件映射到内存（只用于读取），顺序读取与定位读取都直接拷贝映射区
+    Pread,   // 大缓冲区 read/pread 读取，pwrite 写入
+    Uring,   // io_uring：同时有多个大块读/写在途，使用注册的固定缓冲区（仅 Linux 普通文件，不可用时退回 Pread）
+};
+
+// 返回后端名称（用于输出信息）
+const char* fileBackendName(FileBackend backend);
+
+// 由名称（auto/mmap/pread/uring）解析后端
+bool parseFileBackend(const std::string& name, FileBackend& backend);
+
+// 路径 "-" 表示标准输入（读取时）或标准输出（写入时），只在 POSIX 平台上支持
+inline bool isStandardStream(const std::string& path) {
+    return path == "-";
+}
+
+// io_uring 后端的队列与缓冲区（定义在 fileio.cpp）
+struct UringState;
+
+// 顺序读取文件的输入端，另外支持多线程的定位读取 readAt
+// POSIX 下按 FileBackend 选择 mmap、大缓冲区 read/pread 或 io_uring 预读，并用 posix_fadvise 提示顺序访问；
+// 其他平台退回带大缓冲区的 std::ifstream
+class BufferedFileReader : public ByteSource {
+public:
+    static const std::size_t DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+    BufferedFileReader();
     ~BufferedFileReader();
 
-    // ļǷɹ
-    bool open(const std::string& path, std::size_t buffer_size = 64 * 1024);
+    BufferedFileReader(const BufferedFileReader&) = delete;
+    BufferedFileReader& operator=(const BufferedFileReader&) = delete;
+
+    // 打开文件，返回是否成功；指定 Mmap 而文件无法映射时失败，指定 Uring 而不可用时退回 Pread
+    // path 为 "-" 时读取标准输入（重定向自普通文件时与打开该文件相同）
+    bool open(const std::string& path, std::size_t buffer_size = DEFAULT_BUFFER_SIZE,
+        FileBackend backend = FileBackend::Auto);
 
-    // жȡ size ֽڵ bufʵʶȡֽ0 ʾ EOF
+    // 从当前位置顺序读取最多 size 字节，返回实际读取字节数（0 表示 EOF）
+    std::size_t read(uint8_t* buf, std::size_t size) override;
+
+    // 从流中读取最多 size 字节到 buf，返回实际读取字节数（0 表示 EOF）
     std::size_t readChunk(char* buf, std::size_t size);
 
-    // ȡļܴС޷ȡ 0
+    // 从 offset 处读满 size 字节，不改变顺序读取位置；可由多个线程同时调用
+    bool readAt(uint64_t offset, void* buf, std::size_t size);
+
+    // 把顺序读取位置移到 offset（管道等不可定位的输入返回 false）
+    bool seek(uint64_t offset);
+
+    // 当前顺序读取位置
+    uint64_t position() const { return position_; }
+
+    // 获取文件总大小（如果无法获取返回 0）
     uint64_t fileSize() const;
 
+    // 文件大小是否已知（普通文件）
+    bool sizeKnown() const { return size_known_; }
+
+    // 顺序读取是否出过错；出错后 read 也返回 0，要靠这里与 EOF 区分
+    bool failed() const { return failed_; }
+
+    // Mmap 后端下整个文件的只读视图，其他后端返回 nullptr
+    const uint8_t* mappedData() const { return mapped_ ? map_data_ : nullptr; }
+
+    FileBackend backend() const { return backend_; }
+
     void close();
 
-    bool isOpen() const { return in_.is_open(); }
+    bool isOpen() const;
 
 private:
+    // 从文件读取到 buf（Pread 后端），返回读取字节数
+    std::size_t readFile(uint8_t* buf, std::size_t size);
+
+    // 缓冲区读空后取下一块数据，返回是否还有数据
+    bool refill();
+
+    // io_uring：从 offset 起重新提交预读
+    bool startUring(uint64_t offset);
+    bool refillUring();
+
+#if defined(__unix__) || defined(__APPLE__)
+    int fd_ = -1;
+#else
     std::ifstream in_;
-    std::vector<char> buffer_;
-    std::size_t buffer_size_ = 0;
+    std::mutex mutex_;   // 无 pread 时用锁串行化 seek + 读取
+#endif
+    FileBackend backend_ = FileBackend::Pread;
+    const uint8_t* map_data_ = nullptr;
+    bool mapped_ = false;
+    std::vector<uint8_t> buffer_;
+    const uint8_t* buffer_data_ = nullptr;   // 当前缓冲区（buffer_ 或 io_uring 的某个槽）
+    std::size_t buffer_pos_ = 0;
+    std::size_t buffer_end_ = 0;
+    uint64_t position_ = 0;
     uint64_t file_size_ = 0;
+    bool size_known_ = false;
+    bool failed_ = false;
+    std::unique_ptr<UringState> uring_;
 };
 
-class BufferedFileWriter {
+// 顺序写入文件的输出端：数据先攒到大缓冲区，满了再整块写出；
+// 另外支持不经缓冲区的定位写入 writeAt（可由多个线程同时调用）和预分配磁盘空间
+class BufferedFileWriter : public ByteSink {
 public:
-    BufferedFileWriter() = default;
+    static const std::size_t DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+    BufferedFileWriter();
     ~BufferedFileWriter();
 
-    bool open(const std::string& path, std::size_t buffer_size = 64 * 1024);
+    BufferedFileWriter(const BufferedFileWriter&) = delete;
+    BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+    // 打开（截断）文件；指定 Uring 而不可用时退回 Pread，Mmap 与 Auto 都按 Pread 写入
+    // path 为 "-" 时写到标准输出，只能顺序写入（不支持 seek、writeAt、setSize）
+    bool open(const std::string& path, std::size_t buffer_size = DEFAULT_BUFFER_SIZE,
+        FileBackend backend = FileBackend::Auto);
+
+    // 顺序写入 size 字节，返回是否成功
+    bool write(const uint8_t* data, std::size_t size) override;
+
+    // 把缓冲区写到文件
+    bool flush() override;
 
-    // д size ֽڣ bufǷɹ 0 ʾɹ
+    // 写入 size 字节，从 buf，返回是否成功（非 0 表示成功）
     bool writeChunk(const char* buf, std::size_t size);
 
-    // flush ر
-    void close();
+    // 在 offset 处写入 size 字节，不经过缓冲区也不改变顺序写入位置
+    bool writeAt(uint64_t offset, const void* buf, std::size_t size);
+
+    // 写出缓冲区后把顺序写入位置移到 offset（用于回填块表）
+    bool seek(uint64_t offset);
+
+    // 当前顺序写入位置（含缓冲区中尚未写出的数据）
+    uint64_t position() const { return position_; }
+
+    // 预先为 size 字节分配磁盘空间（不改变文件长度），减少碎片与写入时的元数据更新；
+    // 平台不支持时什么也不做并返回 false，不影响后续写入
+    bool preallocate(uint64_t size);
+
+    // 把文件长度设为 size
+    bool setSize(uint64_t size);
 
-    bool isOpen() const { return out_.is_open(); }
+    // flush 并关闭，返回所有写入是否成功
+    bool close();
+
+    bool isOpen() const;
+
+    FileBackend backend() const { return backend_; }
 
 private:
-    std::ofstream out_;
-    std::vector<char> buffer_;
-    std::size_t buffer_size_ = 0;
+    bool writeFile(const uint8_t* data, std::size_t size);
+
+    // 把缓冲区中的数据交出去：同步写出，或提交给 io_uring 并换到下一个槽
+    bool emitBuffer();
+
+#if defined(__unix__) || defined(__APPLE__)
+    int fd_ = -1;
+#else
+    std::fstream out_;
+    std::mutex mutex_;   // 无 pwrite 时用锁串行化 seek + 写入
+#endif
+    std::vector<uint8_t> buffer_;
+    FileBackend backend_ = FileBackend::Pread;
+    uint8_t* buffer_data_ = nullptr;   // 当前缓冲区（buffer_ 或 io_uring 的某个槽）
+    std::size_t buffer_cap_ = 0;
+    std::size_t buffer_used_ = 0;
+    uint64_t position_ = 0;
+    bool failed_ = false;
+    std::unique_ptr<UringState> uring_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -5,26 +5,64 @@
 #include <fstream>
 #include <array>
 #include <string>
+#include <vector>
 #include <iostream>
+#include "fileio.h"
+#include "trace.h"
 
-// ѹļͷл/л
+// 压缩文件头定义与序列化/反序列化工具
 // Magic: 4 bytes, e.g. "LZWC"
 // Version: 1 byte
 // Flags: 1 byte (bitflags for options e.g. preprocessing)
-// Reserved: 2 bytes (/δչ)
+//   bit 0: 码流之前有预处理替换表
+//   bit 1: 写 header 时原始大小未知（从管道流式压缩，仅 version 1/3），OriginalSize 为 0，
+//          真实大小与 CRC-32 写在数据之后的尾部：
+//          Trailer: uint64_t original_size, uint32_t crc32（version 1 紧跟在补齐到字节的 EOF_CODE 之后，
+//          version 3 紧跟在结束标记之后）
+// Reserved: 2 bytes (对齐/未来扩展)
 // OriginalSize: uint64_t (8 bytes)
-// Extra: uint16_t max_code_width (2 bytes)  12
+// Extra: uint16_t max_code_width (2 bytes) 最大码宽（例如 12）
+// Version 2（分块格式）在此之后追加：
+//   BlockSize: uint32_t (4 bytes) 每块原始大小（最后一块可以更小）
+//   BlockCount: uint32_t (4 bytes)
+//   BlockTable: BlockCount * { uint32_t compressed_size, uint32_t original_size }
+// 之后按顺序存放各块独立的 LZW 码流（每块以 EOF_CODE 结束并补齐到字节）
+// Version 3（W3C 日志列式格式）在此之后追加：
+//   ChunkSize: uint32_t (4 bytes) 每段原始大小的上限
+// 之后是按行对齐的各段，每段内各列是独立的 LZW 码流，详见 columnar.h
+// Version 4（多文件归档）在此之后追加：
+//   MemberCount: uint32_t (4 bytes)
+//   Directory: MemberCount * { uint16_t name_length, name (UTF-8，以 / 分隔的相对路径),
+//                              uint64_t original_size, uint64_t offset, uint64_t compressed_size }
+// 之后是各成员独立的 LZW 码流，按压缩完成的先后存放，位置由目录中的 offset 给出
+// OriginalSize 为所有成员原始大小之和
 
 struct ArchiveHeader {
     std::array<char, 4> magic; // e.g. {'L','Z','W','C'}
-    uint8_t version;          // 1
-    uint8_t flags;            // bit flags: bit 0 = has_preprocessing
-    uint16_t reserved;        // 
-    uint64_t original_size;   // ԭʼļСֽڣ
-    uint16_t max_code_width;  //  12
+    uint8_t version;          // 1 = 单一码流, 2 = 分块, 3 = 列式, 4 = 多文件
+    uint8_t flags;            // bit flags: bit 0 = has_preprocessing, bit 1 = size_unknown
+    uint16_t reserved;        // 保留对齐
+    uint64_t original_size;   // 原始文件大小（字节）
+    uint16_t max_code_width;  // 最大码宽（例如 12）
+    uint32_t block_size;      // version 2 为块大小，version 3 为段大小上限
+    uint32_t block_count;     // version 2 为块数，version 4 为成员数
 
-    // Flag λ
+    // 版本定义
+    static const uint8_t VERSION_STREAM = 1;
+    static const uint8_t VERSION_BLOCKED = 2;
+    static const uint8_t VERSION_COLUMNAR = 3;
+    static const uint8_t VERSION_MULTI = 4;
+
+    // Flag 位定义
     static const uint8_t FLAG_HAS_PREPROCESSING = 0x01;
+    static const uint8_t FLAG_SIZE_UNKNOWN = 0x02;
+
+    // 支持的码宽范围
+    static const uint16_t MIN_CODE_WIDTH = 9;
+    static const uint16_t MAX_CODE_WIDTH = 20;
+
+    // 分块、分段大小的上限，与 --block-size 的取值范围（1-256 MB）一致
+    static const uint32_t MAX_BLOCK_SIZE = 256u * 1024 * 1024;
 
     ArchiveHeader() {
         magic = { 'L','Z','W','C' };
@@ -33,14 +71,31 @@ struct ArchiveHeader {
         reserved = 0;
         original_size = 0;
         max_code_width = 12;
+        block_size = 0;
+        block_count = 0;
+    }
+
+    // 是否为分块格式
+    bool isBlocked() const {
+        return version == VERSION_BLOCKED;
+    }
+
+    // 是否为列式格式
+    bool isColumnar() const {
+        return version == VERSION_COLUMNAR;
     }
 
-    // ǷԤ
+    // 是否为多文件归档
+    bool isMulti() const {
+        return version == VERSION_MULTI;
+    }
+
+    // 检查是否启用了预处理
     bool hasPreprocessing() const {
         return (flags & FLAG_HAS_PREPROCESSING) != 0;
     }
 
-    // Ԥ־
+    // 设置预处理标志
     void setPreprocessing(bool enabled) {
         if (enabled) {
             flags |= FLAG_HAS_PREPROCESSING;
@@ -49,79 +104,216 @@ struct ArchiveHeader {
             flags &= ~FLAG_HAS_PREPROCESSING;
         }
     }
+
+    // 原始大小是否要从尾部读取
+    bool sizeUnknown() const {
+        return (flags & FLAG_SIZE_UNKNOWN) != 0;
+    }
+
+    // 设置原始大小未知标志
+    void setSizeUnknown(bool unknown) {
+        if (unknown) {
+            flags |= FLAG_SIZE_UNKNOWN;
+        }
+        else {
+            flags &= ~FLAG_SIZE_UNKNOWN;
+        }
+    }
+};
+
+// 分块格式中每块的表项
+struct BlockEntry {
+    uint32_t compressed_size; // 压缩后字节数
+    uint32_t original_size;   // 原始字节数
+};
+
+// 原始大小未知的归档在数据之后的尾部
+struct ArchiveTrailer {
+    static const size_t SIZE = 12;
+
+    uint64_t original_size = 0;
+    uint32_t crc32 = 0;       // 原始数据的 CRC-32（checksum.h）
 };
 
-// Helper: write a little-endian integer to stream
-inline void write_le(std::ofstream& out, const uint16_t v) {
-    uint8_t b0 = v & 0xFF;
-    uint8_t b1 = (v >> 8) & 0xFF;
-    out.put(static_cast<char>(b0));
-    out.put(static_cast<char>(b1));
+// 多文件归档目录中的一项
+struct MemberEntry {
+    static const size_t MAX_NAME = 4096;  // 成员名的长度上限
+
+    std::string name;          // 相对路径，以 / 分隔
+    uint64_t original_size;    // 原始字节数
+    uint64_t offset;           // 码流在归档中的偏移
+    uint64_t compressed_size;  // 码流字节数
+};
+
+// Helper: append a little-endian integer to a byte buffer
+inline void write_le(std::vector<uint8_t>& out, const uint16_t v) {
+    out.push_back(static_cast<uint8_t>(v & 0xFF));
+    out.push_back(static_cast<uint8_t>((v >> 8) & 0xFF));
 }
 
-inline void write_le(std::ofstream& out, const uint64_t v) {
+inline void write_le(std::vector<uint8_t>& out, const uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>((v >> (8 * i)) & 0xFF));
+    }
+}
+
+inline void write_le(std::vector<uint8_t>& out, const uint64_t v) {
     for (int i = 0; i < 8; ++i) {
-        out.put(static_cast<char>((v >> (8 * i)) & 0xFF));
+        out.push_back(static_cast<uint8_t>((v >> (8 * i)) & 0xFF));
     }
 }
 
-// Helper: read little-endian integer from stream
-inline bool read_le(std::ifstream& in, uint16_t& out_v) {
-    int b0 = in.get();
-    if (b0 == EOF) return false;
-    int b1 = in.get();
-    if (b1 == EOF) return false;
-    out_v = static_cast<uint16_t>(uint8_t(b0) | (uint16_t(uint8_t(b1)) << 8));
+// Helper: read little-endian integer from a byte source
+inline bool read_le(ByteSource& in, uint16_t& out_v) {
+    uint8_t b[2];
+    if (!readExact(in, b, 2)) return false;
+    out_v = static_cast<uint16_t>(b[0] | (uint16_t(b[1]) << 8));
+    return true;
+}
+
+inline bool read_le(ByteSource& in, uint32_t& out_v) {
+    uint8_t b[4];
+    if (!readExact(in, b, 4)) return false;
+    out_v = 0;
+    for (int i = 0; i < 4; ++i) {
+        out_v |= (uint32_t(b[i]) << (8 * i));
+    }
     return true;
 }
 
-inline bool read_le(std::ifstream& in, uint64_t& out_v) {
+inline bool read_le(ByteSource& in, uint64_t& out_v) {
+    uint8_t b[8];
+    if (!readExact(in, b, 8)) return false;
     out_v = 0;
     for (int i = 0; i < 8; ++i) {
-        int b = in.get();
-        if (b == EOF) return false;
-        out_v |= (uint64_t(uint8_t(b)) << (8 * i));
+        out_v |= (uint64_t(b[i]) << (8 * i));
     }
     return true;
 }
 
-// д header ofstream must be opened binary
-inline bool writeHeader(std::ofstream& out, const ArchiveHeader& h) {
-    if (!out) return false;
+// 写 header 到输出端（先在内存中拼好，一次写出）
+inline bool writeHeader(ByteSink& out, const ArchiveHeader& h) {
+    TraceScope trace("writeHeader", "header");
+    std::vector<uint8_t> bytes;
     // magic 4 bytes
-    out.write(h.magic.data(), 4);
+    bytes.insert(bytes.end(), h.magic.begin(), h.magic.end());
     // version and flags
-    out.put(static_cast<char>(h.version));
-    out.put(static_cast<char>(h.flags));
+    bytes.push_back(h.version);
+    bytes.push_back(h.flags);
     // reserved (2 bytes little-endian)
-    write_le(out, h.reserved);
+    write_le(bytes, h.reserved);
     // original_size (8 bytes little-endian)
-    write_le(out, h.original_size);
+    write_le(bytes, h.original_size);
     // max_code_width (2 bytes)
-    write_le(out, h.max_code_width);
-    return out.good();
+    write_le(bytes, h.max_code_width);
+    if (h.isBlocked()) {
+        write_le(bytes, h.block_size);
+        write_le(bytes, h.block_count);
+    }
+    else if (h.isColumnar()) {
+        write_le(bytes, h.block_size);
+    }
+    else if (h.isMulti()) {
+        write_le(bytes, h.block_count);
+    }
+    return out.write(bytes.data(), bytes.size());
 }
 
-// ȡ headerifstream must be opened binary
-inline bool readHeader(std::ifstream& in, ArchiveHeader& h) {
-    if (!in) return false;
-    char mag[4];
-    in.read(mag, 4);
-    if (in.gcount() != 4) return false;
-    for (int i = 0; i < 4; ++i) h.magic[i] = mag[i];
-    int v = in.get();
-    if (v == EOF) return false;
-    h.version = static_cast<uint8_t>(v);
-    v = in.get();
-    if (v == EOF) return false;
-    h.flags = static_cast<uint8_t>(v);
+// 读取 header
+inline bool readHeader(ByteSource& in, ArchiveHeader& h) {
+    TraceScope trace("readHeader", "header");
+    uint8_t head[6];
+    if (!readExact(in, head, sizeof(head))) return false;
+    for (int i = 0; i < 4; ++i) h.magic[i] = static_cast<char>(head[i]);
+    h.version = head[4];
+    h.flags = head[5];
     if (!read_le(in, h.reserved)) return false;
     if (!read_le(in, h.original_size)) return false;
     if (!read_le(in, h.max_code_width)) return false;
+    if (h.isBlocked()) {
+        if (!read_le(in, h.block_size)) return false;
+        if (!read_le(in, h.block_count)) return false;
+    }
+    else if (h.isColumnar()) {
+        if (!read_le(in, h.block_size)) return false;
+    }
+    else if (h.isMulti()) {
+        if (!read_le(in, h.block_count)) return false;
+    }
+    return true;
+}
+
+// 写块表（紧跟在 version 2 的 header 之后）
+inline bool writeBlockTable(ByteSink& out, const std::vector<BlockEntry>& table) {
+    TraceScope trace("writeBlockTable", "header");
+    std::vector<uint8_t> bytes;
+    bytes.reserve(table.size() * 8);
+    for (const auto& e : table) {
+        write_le(bytes, e.compressed_size);
+        write_le(bytes, e.original_size);
+    }
+    return out.write(bytes.data(), bytes.size());
+}
+
+// 读块表
+inline bool readBlockTable(ByteSource& in, uint32_t count, std::vector<BlockEntry>& table) {
+    TraceScope trace("readBlockTable", "header");
+    table.resize(count);
+    for (auto& e : table) {
+        if (!read_le(in, e.compressed_size)) return false;
+        if (!read_le(in, e.original_size)) return false;
+    }
+    return true;
+}
+
+// 写尾部
+inline bool writeTrailer(ByteSink& out, const ArchiveTrailer& t) {
+    TraceScope trace("writeTrailer", "header");
+    std::vector<uint8_t> bytes;
+    write_le(bytes, t.original_size);
+    write_le(bytes, t.crc32);
+    return out.write(bytes.data(), bytes.size());
+}
+
+// 读尾部
+inline bool readTrailer(ByteSource& in, ArchiveTrailer& t) {
+    TraceScope trace("readTrailer", "header");
+    return read_le(in, t.original_size) && read_le(in, t.crc32);
+}
+
+// 写成员目录（紧跟在 version 4 的 header 之后）
+inline bool writeMemberDirectory(ByteSink& out, const std::vector<MemberEntry>& members) {
+    TraceScope trace("writeMemberDirectory", "header");
+    std::vector<uint8_t> bytes;
+    for (const auto& m : members) {
+        write_le(bytes, static_cast<uint16_t>(m.name.size()));
+        bytes.insert(bytes.end(), m.name.begin(), m.name.end());
+        write_le(bytes, m.original_size);
+        write_le(bytes, m.offset);
+        write_le(bytes, m.compressed_size);
+    }
+    return out.write(bytes.data(), bytes.size());
+}
+
+// 读成员目录
+inline bool readMemberDirectory(ByteSource& in, uint32_t count, std::vector<MemberEntry>& members) {
+    TraceScope trace("readMemberDirectory", "header");
+    members.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+        MemberEntry m;
+        uint16_t length;
+        if (!read_le(in, length) || length == 0 || length > MemberEntry::MAX_NAME) return false;
+        m.name.resize(length);
+        if (!readExact(in, &m.name[0], length)) return false;
+        if (!read_le(in, m.original_size)) return false;
+        if (!read_le(in, m.offset)) return false;
+        if (!read_le(in, m.compressed_size)) return false;
+        members.push_back(std::move(m));
+    }
     return true;
 }
 
-// У magic Ƿƥ
+// 校验 magic 是否匹配
 inline bool headerMagicOk(const ArchiveHeader& h) {
     return h.magic[0] == 'L' && h.magic[1] == 'Z' && h.magic[2] == 'W' && h.magic[3] == 'C';
 }
@@ -144,120 +336,120 @@ inline std::string magicToString(const ArchiveHeader& h) {
 //#include <cstdint>
 //#include <array>
 //
-///*ħʶʶļ
+///*魔数标识：快速识别文件类型
 //
-//汾ƣָ֧ʽݽ
+//版本控制：支持格式演进
 //
-//С򣺼x86ܹ
+//小端序：兼容x86架构
 //
-//չԣֶκͱ־λΪδԤռ
+//扩展性：保留字段和标志位为未来功能预留空间
 //
-//Լ飺ԭʼļС֤
+//完整性检查：包含原始文件大小用于验证
 //
-//ʽΪLZWѹ㷨ṩ˱׼ļ*/
+//这个格式设计为LZW压缩算法提供了标准化的文件容器。*/
 //
 //struct ArchiveHeader {
-//    std::array<char,4> magic; // ļʶ {'L','Z','W','C'}
-//    uint8_t version;          // ʽ汾
-//    uint8_t flags;            // ܱ־λ bit flags, 0 ʾĬ
-//    uint16_t reserved;        // ֶΣڶչ
-//    uint64_t original_size;   // ԭʼļС8ֽڣ
-//    uint16_t max_code_width;  // ȣ12λ
+//    std::array<char,4> magic; // 文件标识符 {'L','Z','W','C'}
+//    uint8_t version;          // 格式版本号
+//    uint8_t flags;            // 功能标志位 bit flags, 0 表示默认
+//    uint16_t reserved;        // 保留字段，用于对齐和扩展
+//    uint64_t original_size;   // 原始文件大小（8字节）
+//    uint16_t max_code_width;  // 最大编码宽度（如12位）
 //
 //    ArchiveHeader() {
-//        magic = { 'L','Z','W','C' };//ħʶ
-//        version = 1;//汾1
-//        flags = 0;//Ĭ־
-//        reserved = 0;//λ
-//		original_size = 0;//ʼԭʼСΪ0
-//		max_code_width = 12; // Ĭ12λ
+//        magic = { 'L','Z','W','C' };//设置魔数标识
+//        version = 1;//版本1
+//        flags = 0;//默认无特殊标志
+//        reserved = 0;//保留位清零
+//		original_size = 0;//初始原始大小为0
+//		max_code_width = 12; // 默认最大编码宽度12位
 //    }
-//};//ѹļͷϢܹ4+1+1+2+8+2=18ֽڣ
+//};//定义了压缩文件的头部信息，总共4+1+1+2+8+2=18字节？
 //
-//// д16λС
+//// 写入16位整数（小端序）
 //inline void write_le(std::ofstream& out, const uint16_t v) {
-//    uint8_t b0 = v & 0xFF;//8λ
-//	uint8_t b1 = (v >> 8) & 0xFF;//8λ
-//	out.put(static_cast<char>(b0));//д8λ
-//	out.put(static_cast<char>(b1));//д8λ
+//    uint8_t b0 = v & 0xFF;//低8位
+//	uint8_t b1 = (v >> 8) & 0xFF;//高8位
+//	out.put(static_cast<char>(b0));//先写低8位
+//	out.put(static_cast<char>(b1));//再写高8位
 //}
 //
-//// д64λС
+//// 写入64位整数（小端序）
 //inline void write_le(std::ofstream& out, const uint64_t v) {
 //    for (int i = 0; i < 8; ++i) {
-//        // ֽڵֽд
+//        // 从最低字节到最高字节依次写入
 //        out.put(static_cast<char>((v >> (8 * i)) & 0xFF));
 //    }
 //}
 //
-//// ȡ16λС
+//// 读取16位整数（小端序）
 //inline bool read_le(std::ifstream& in, uint16_t& out_v) {
-//    int b0 = in.get();//ȡֽ
+//    int b0 = in.get();//读取低字节
 //    if (b0 == EOF) return false;
-//	int b1 = in.get();//ȡֽ
+//	int b1 = in.get();//读取高字节
 //    if (b1 == EOF) return false;
-//	//ϳ16λֽǰֽں<=8)
+//	//组合成16位整数：低字节在前，高字节在后（<=8)
 //    out_v = static_cast<uint16_t>(uint8_t(b0) | (uint16_t(uint8_t(b1)) << 8));
 //    return true;
 //}
 //
-//// ȡ64λС
+//// 读取64位整数（小端序）
 //inline bool read_le(std::ifstream& in, uint64_t& out_v) {
 //    out_v = 0;
 //    for (int i = 0; i < 8; ++i) {
-//        int b = in.get(); //ζȡ8ֽ
+//        int b = in.get(); //依次读取8个字节
 //        if (b == EOF) return false;
-//        // ÿֽڷŵȷλ
+//        // 将每个字节放到正确位置
 //        out_v |= (uint64_t(uint8_t(b)) << (8 * i));
 //    }
 //    return true;
 //}
 //
-//// д header ofstream must be opened binary
+//// 写 header 到输出流（ofstream must be opened binary）
 //inline bool writeHeader(std::ofstream& out, const ArchiveHeader& h) {
 //    if (!out) return false;
 //
-//    // ˳дֶΣ
-//	out.write(h.magic.data(), 4);//4ֽħ
-//	out.put(static_cast<char>(h.version));//1ֽڰ汾
-//	out.put(static_cast<char>(h.flags));//1ֽڱ־λ
-//	write_le(out, h.reserved);//2ֽڱλ
-//	write_le(out, h.original_size);//8ֽԭʼļС
-//	write_le(out, h.max_code_width);//2ֽ
+//    // 按顺序写入各个字段：
+//	out.write(h.magic.data(), 4);//4字节魔数
+//	out.put(static_cast<char>(h.version));//1字节版本号
+//	out.put(static_cast<char>(h.flags));//1字节标志位
+//	write_le(out, h.reserved);//2字节保留位
+//	write_le(out, h.original_size);//8字节原始文件大小
+//	write_le(out, h.max_code_width);//2字节最大编码宽度
 //
-//	return out.good();//дǷɹ
+//	return out.good();//检查写入是否成功
 //}
 //
-//// ȡ headerifstream must be opened binary
+//// 读取 header（ifstream must be opened binary）
 //inline bool readHeader(std::ifstream& in, ArchiveHeader& h) {
 //    if (!in) return false;
 //
 //    char mag[4];
-//	in.read(mag, 4);//ȡ4ֽħ
-//	if (in.gcount() != 4) return false;//Ƿɹȡ4ֽ
-//	for (int i = 0; i < 4; ++i) h.magic[i] = mag[i];//Ƶṹ
+//	in.read(mag, 4);//读取4字节魔数
+//	if (in.gcount() != 4) return false;//检查是否成功读取4字节
+//	for (int i = 0; i < 4; ++i) h.magic[i] = mag[i];//复制到结构体中
 //
-//	int v = in.get();//ȡ汾
+//	int v = in.get();//读取版本号
 //    if (v == EOF) return false;
 //    h.version = static_cast<uint8_t>(v);
 //
-//	v = in.get();//ȡ־λ
+//	v = in.get();//读取标志位
 //    if (v == EOF) return false;
 //    h.flags = static_cast<uint8_t>(v);
 //
-//	//ȡʣֶΣС
+//	//读取剩余字段（小端序）
 //    if (!read_le(in, h.reserved)) return false;
 //    if (!read_le(in, h.original_size)) return false;
 //    if (!read_le(in, h.max_code_width)) return false;
 //    return true;
 //}
 //
-////֤ħǷȷ
+////验证魔数是否正确
 //inline bool headerMagicOk(const ArchiveHeader& h) {
 //    return h.magic[0] == 'L' && h.magic[1] == 'Z' && h.magic[2] == 'W' && h.magic[3] == 'C';
 //}
 //
-////ħַתΪַڵԣ
+////将魔数字符数组转换为字符串（用于调试）
 //inline std::string magicToString(const ArchiveHeader& h) {
 //    return std::string(h.magic.data(), 4);
 //}
@@ -0,0 +1,181 @@
+#include "io_uring_queue.h"
+
+#ifdef FILEIO_HAS_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+IoUringQueue::~IoUringQueue() {
+    close();
+}
+
+bool IoUringQueue::init(unsigned entries) {
+    close();
+#ifdef __NR_io_uring_setup
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) return false;
+    fd_ = fd;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        close();
+        return false;
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    }
+    else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            close();
+            return false;
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_ring_);
+    char* cq = static_cast<char*>(cq_ring_);
+    sq_entries_ = params.sq_entries;
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+#else
+    (void)entries;
+    return false;
+#endif
+}
+
+bool IoUringQueue::registerBuffers(const std::vector<std::pair<void*, std::size_t>>& buffers) {
+    if (fd_ < 0 || buffers.empty()) return false;
+    std::vector<iovec> iov(buffers.size());
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+        iov[i].iov_base = buffers[i].first;
+        iov[i].iov_len = buffers[i].second;
+    }
+    // 固定缓冲区受 RLIMIT_MEMLOCK 限制，失败时调用方继续用普通读写
+    long ret = syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov.data(), static_cast<unsigned>(iov.size()));
+    fixed_buffers_ = ret == 0;
+    return fixed_buffers_;
+}
+
+bool IoUringQueue::prepare(uint8_t opcode, int fd, const void* buf, unsigned len, uint64_t offset,
+    int buf_index, uint64_t user_data) {
+    unsigned tail = *sq_tail_;
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (tail - head >= sq_entries_) return false;
+
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    if (buf_index >= 0) {
+        sqe->buf_index = static_cast<uint16_t>(buf_index);
+    }
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    pending_++;
+    return true;
+}
+
+bool IoUringQueue::prepareRead(int fd, void* buf, unsigned len, uint64_t offset, int buf_index, uint64_t user_data) {
+    bool fixed = fixed_buffers_ && buf_index >= 0;
+    return prepare(fixed ? IORING_OP_READ_FIXED : IORING_OP_READ, fd, buf, len, offset, fixed ? buf_index : -1, user_data);
+}
+
+bool IoUringQueue::prepareWrite(int fd, const void* buf, unsigned len, uint64_t offset, int buf_index, uint64_t user_data) {
+    bool fixed = fixed_buffers_ && buf_index >= 0;
+    return prepare(fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE, fd, buf, len, offset, fixed ? buf_index : -1, user_data);
+}
+
+int IoUringQueue::enter(unsigned to_submit, unsigned min_complete) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0);
+        if (ret >= 0) return static_cast<int>(ret);
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return -1;
+    }
+}
+
+bool IoUringQueue::submit() {
+    while (pending_ > 0) {
+        int submitted = enter(pending_, 0);
+        if (submitted <= 0) return false;
+        pending_ -= static_cast<unsigned>(submitted);
+    }
+    return true;
+}
+
+bool IoUringQueue::wait(uint64_t& user_data, int32_t& result) {
+    for (;;) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            const io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+            user_data = cqe->user_data;
+            result = cqe->res;
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        int submitted = enter(pending_, 1);
+        if (submitted < 0) return false;
+        pending_ -= std::min(pending_, static_cast<unsigned>(submitted));
+    }
+}
+
+void IoUringQueue::close() {
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    sq_ring_ = cq_ring_ = nullptr;
+    sqes_ = nullptr;
+    pending_ = 0;
+    fixed_buffers_ = false;
+}
+
+#endif
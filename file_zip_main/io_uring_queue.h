@@ -0,0 +1,78 @@
+#ifndef IO_URING_QUEUE_H
+#define IO_URING_QUEUE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 只在 Linux 且有内核头文件时编译 io_uring 后端（直接使用系统调用，不依赖 liburing）
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FILEIO_HAS_IO_URING 1
+#endif
+#endif
+
+#ifdef FILEIO_HAS_IO_URING
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// 最小的 io_uring 封装：提交定长读写、等待完成，支持注册固定缓冲区
+class IoUringQueue {
+public:
+    IoUringQueue() = default;
+    ~IoUringQueue();
+
+    IoUringQueue(const IoUringQueue&) = delete;
+    IoUringQueue& operator=(const IoUringQueue&) = delete;
+
+    // 建立至少 entries 项的提交队列，内核不支持或被禁止时返回 false
+    bool init(unsigned entries);
+
+    // 注册固定缓冲区，之后可用 buf_index 提交 READ_FIXED / WRITE_FIXED
+    bool registerBuffers(const std::vector<std::pair<void*, std::size_t>>& buffers);
+
+    bool hasFixedBuffers() const { return fixed_buffers_; }
+
+    // 准备一个读/写请求（buf_index < 0 时不使用固定缓冲区），提交队列已满时返回 false
+    bool prepareRead(int fd, void* buf, unsigned len, uint64_t offset, int buf_index, uint64_t user_data);
+    bool prepareWrite(int fd, const void* buf, unsigned len, uint64_t offset, int buf_index, uint64_t user_data);
+
+    // 把已准备的请求交给内核
+    bool submit();
+
+    // 等待一个完成事件（需要时先提交），返回请求的 user_data 与结果（字节数或 -errno）
+    bool wait(uint64_t& user_data, int32_t& result);
+
+    void close();
+
+    bool isOpen() const { return fd_ >= 0; }
+
+private:
+    bool prepare(uint8_t opcode, int fd, const void* buf, unsigned len, uint64_t offset,
+        int buf_index, uint64_t user_data);
+    int enter(unsigned to_submit, unsigned min_complete);
+
+    int fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqes_size_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned pending_ = 0;   // 已准备、尚未提交的请求数
+    bool fixed_buffers_ = false;
+};
+
+#endif
+
+#endif
@@ -1,26 +1,65 @@
 #include "lzw_compress.h"
+#include "trace.h"
 #include <iostream>
-#include<sstream>
+#include <algorithm>
+
+LZWEncoderTable::LZWEncoderTable(int initial_code_width, int max_code_width) {
+    // 装载因子不超过 1/2：槽位数为条目数的两倍
+    initial_slots_ = size_t(1) << (initial_code_width + 1);
+    max_slots_ = size_t(1) << (max_code_width + 1);
+    resize(initial_slots_);
+}
+
+void LZWEncoderTable::resize(size_t slot_count) {
+    slots_.assign(slot_count, 0);
+    mask_ = slot_count - 1;
+    shift_ = 32;
+    while ((size_t(1) << (32 - shift_)) < slot_count) {
+        shift_--;
+    }
+    count_ = 0;
+}
+
+void LZWEncoderTable::clear() {
+    // assign 缩小时保留已分配的容量，只清零初始大小部分
+    resize(initial_slots_);
+}
+
+void LZWEncoderTable::grow() {
+    std::vector<uint64_t> old;
+    old.swap(slots_);
+    size_t count = count_;
+    resize(old.size() * 2);
+
+    for (uint64_t entry : old) {
+        if (entry == 0) continue;
+        size_t i = hash(entry >> 32);
+        while (slots_[i] != 0) {
+            i = (i + 1) & mask_;
+        }
+        slots_[i] = entry;
+    }
+    count_ = count;
+}
 
 LZWCompressor::LZWCompressor(const LZWCompressOptions& options)
-    : options_(options), next_code_(FIRST_CODE),
+    : options_(options), dictionary_(options.initial_code_width, options.max_code_width),
+    current_(LZWEncoderTable::NOT_FOUND), next_code_(FIRST_CODE),
     current_code_width_(options.initial_code_width),
-    input_size_(0), dict_size_(0), codes_written_(0) {
+    input_size_(0), dict_size_(0), codes_written_(0), reset_count_(0),
+    window_active_(false), window_start_input_(0), window_start_bits_(0), best_ratio_(0) {
     initDictionary();
 }
 
 void LZWCompressor::initDictionary() {
+    // 单字节字符 (0-255) 隐式对应码 0-255，表中只保存多字节序列
     dictionary_.clear();
 
-    // еַֽ (0-255)
-    for (int i = 0; i < 256;++i) {
-        std::string s(1, static_cast<char>(i));
-        dictionary_[s] = static_cast<uint32_t>(i);
-    }
-
     next_code_ = FIRST_CODE;
     current_code_width_ = options_.initial_code_width;
-    dict_size_ = dictionary_.size();
+    dict_size_ = 256;
+    window_active_ = false;
+    best_ratio_ = 0;
 }
 
 void LZWCompressor::clearDictionary() {
@@ -36,108 +75,196 @@ bool LZWCompressor::isDictionaryFull() const {
     return next_code_ >= (1U << options_.max_code_width);
 }
 
+bool LZWCompressor::shouldReset(uint64_t input_pos, const BitWriter& out) {
+    if (!options_.use_clear_code) return false;
+    if (options_.reset_mode == LZWResetMode::OnFull) return true;
+    if (options_.reset_mode != LZWResetMode::Adaptive) return false;
+
+    // 刚写满：从这里开始第一个窗口
+    if (!window_active_) {
+        window_active_ = true;
+        window_start_input_ = input_pos;
+        window_start_bits_ = out.getBitsWritten();
+        return false;
+    }
+
+    if (input_pos - window_start_input_ < options_.ratio_window) return false;
+
+    uint64_t in_bits = (input_pos - window_start_input_) * 8;
+    uint64_t out_bits = out.getBitsWritten() - window_start_bits_;
+    double ratio = out_bits > 0 ? double(in_bits) / double(out_bits) : 0;
+
+    window_start_input_ = input_pos;
+    window_start_bits_ = out.getBitsWritten();
+
+    if (best_ratio_ > 0 && ratio < best_ratio_ * (1.0 - options_.ratio_threshold)) {
+        return true;
+    }
+    if (ratio > best_ratio_) {
+        best_ratio_ = ratio;
+    }
+    return false;
+}
+
 bool LZWCompressor::writeCode(BitWriter& out, uint32_t code) {
     codes_written_++;
     return out.write(code, current_code_width_);
 }
 
-bool LZWCompressor::compressStream(std::ifstream& in, BitWriter& out) {
-    if (!in.good()) return false;
-
+void LZWCompressor::beginStream() {
     initDictionary();
+    current_ = LZWEncoderTable::NOT_FOUND;
     input_size_ = 0;
     codes_written_ = 0;
+    reset_count_ = 0;
+#if LZW_ENABLE_STATS
+    stats_ = CoderCounters();
+    fill_start_ = statsNow();
+#endif
+}
+
+void LZWCompressor::publishStats(const BitWriter& out, uint64_t start_bits) {
+#if LZW_ENABLE_STATS
+    stats_.streams = 1;
+    stats_.input_bytes = input_size_;
+    stats_.output_bytes = (out.getBitsWritten() - start_bits + 7) / 8;
+    stats_.codes = codes_written_;
+    stats_.resets = reset_count_;
+    statsAddEncoder(stats_);
+#else
+    (void)out;
+    (void)start_bits;
+#endif
+}
 
-    std::string current;
-    int ch;
+bool LZWCompressor::compressChunk(const uint8_t* data, size_t size, BitWriter& out) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    uint32_t current = current_;  // 当前序列的码
+    uint64_t input_base = input_size_;
+    uint64_t probes = 0;
 
-    while ((ch = in.get()) != EOF) {
-        input_size_++;
-        char byte = static_cast<char>(ch);
-        std::string next = current + byte;
+    input_size_ += size;
 
-        if (dictionary_.find(next) != dictionary_.end()) {
-            // ֵҵȡ
+    if (current == LZWEncoderTable::NOT_FOUND) {
+        if (p == end) return true;
+        current = *p++;
+    }
+    LZW_STAT(stats_.lookups += static_cast<uint64_t>(end - p));
+
+    while (p != end) {
+        uint8_t byte = *p++;
+
+        size_t slot;
+        uint32_t next = dictionary_.find(current, byte, slot, probes);
+        if (next != LZWEncoderTable::NOT_FOUND) {
+            // 在字典中找到，继续读取
             current = next;
+            continue;
+        }
+
+        // 没找到，输出当前序列的代码
+        if (!writeCode(out, current)) {
+            return false;
         }
-        else {
-            // ûҵǰеĴ
-            if (!current.empty()) {
-                auto it = dictionary_.find(current);
-                if (it == dictionary_.end()) {
-                    std::cerr << "Error: sequence not in dictionary: " << current << std::endl;
-                    return false;
-                }
-
-                if (!writeCode(out, it->second)) {
-                    return false;
-                }
-            }
 
-            // ӵֵ䣨пռ䣩
-            if (!isDictionaryFull()) {
-                dictionary_[next] = next_code_++;
-                dict_size_++;
+        // 将新序列添加到字典（如果还有空间）
+        if (!isDictionaryFull()) {
+            dictionary_.insertAt(slot, current, byte, next_code_++);
+            dict_size_++;
 
-                // ǷҪ
-                if (shouldIncreaseCodeWidth()) {
-                    current_code_width_++;
-                }
+            // 检查是否需要增加码宽
+            if (shouldIncreaseCodeWidth()) {
+                current_code_width_++;
+                LZW_STAT(stats_.width_changes++;
+                    stats_.addEvent(CoderEvent::Widen, current_code_width_, input_base + static_cast<uint64_t>(p - data)));
+            }
+#if LZW_ENABLE_STATS
+            if (isDictionaryFull()) {
+                stats_.dictionary_fills++;
+                stats_.fill_nanoseconds += statsNow() - fill_start_;
+                stats_.addEvent(CoderEvent::Full, current_code_width_, input_base + static_cast<uint64_t>(p - data));
+            }
+#endif
+        }
+        else if (shouldReset(input_base + static_cast<uint64_t>(p - data), out)) {
+            // 字典满了且压缩率变差，发送清空代码并重新初始化
+            if (!writeCode(out, CLEAR_CODE)) {
+                return false;
             }
-            //else if (options_.use_clear_code) {
-            //    // ֵˣմ벢³ʼ
-            //    if (!writeCode(out, CLEAR_CODE)) {
-            //        return false;
-            //    }
-            //    clearDictionary();
-            //}
-
-            // ʼµ
-            current = std::string(1, byte);
+            clearDictionary();
+            reset_count_++;
+            LZW_STAT(fill_start_ = statsNow();
+                stats_.addEvent(CoderEvent::Reset, current_code_width_, input_base + static_cast<uint64_t>(p - data)));
         }
+
+        // 开始新的序列
+        current = byte;
     }
 
-    // 
-    if (!current.empty()) {
-        auto it = dictionary_.find(current);
-        if (it == dictionary_.end()) {
-            std::cerr << "Error: final sequence not in dictionary" << std::endl;
-            return false;
-        }
+    current_ = current;
+    LZW_STAT(stats_.probes += probes);
+    return true;
+}
 
-        if (!writeCode(out, it->second)) {
+bool LZWCompressor::finishStream(BitWriter& out) {
+    // 输出最后的序列
+    if (current_ != LZWEncoderTable::NOT_FOUND) {
+        if (!writeCode(out, current_)) {
             return false;
         }
+        current_ = LZWEncoderTable::NOT_FOUND;
     }
 
-    // дEOF
-    if (!writeCode(out, EOF_CODE)) {
+    // 写入EOF代码
+    return writeCode(out, EOF_CODE);
+}
+
+bool LZWCompressor::compressBuffer(const uint8_t* data, size_t size, BitWriter& out) {
+    StageScope stage(Stage::Code);
+    TraceScope trace("compressBuffer", "lzw");
+    trace.setBytes(size);
+    uint64_t start_bits = out.getBitsWritten();
+    beginStream();
+    if (!compressChunk(data, size, out) || !finishStream(out)) {
         return false;
     }
-
+    stage.addBytes(size, (out.getBitsWritten() - start_bits) / 8);
+    publishStats(out, start_bits);
     return true;
 }
 
-bool LZWCompressor::compressString(const std::string& input, BitWriter& out) {
-    std::istringstream iss(input);
-    std::ifstream dummy;
-
-    // ַݸƵʱ
-    std::string temp_filename = "/tmp/lzw_temp_" + std::to_string(reinterpret_cast<uintptr_t>(this));
-    std::ofstream temp_out(temp_filename, std::ios::binary);
-    if (!temp_out) return false;
-
-    temp_out << input;
-    temp_out.close();
+bool LZWCompressor::compressStream(std::ifstream& in, BitWriter& out) {
+    if (!in.good()) return false;
+    StreamByteSource source(in);
+    return compressStream(source, out);
+}
 
-    std::ifstream temp_in(temp_filename, std::ios::binary);
-    if (!temp_in) return false;
+bool LZWCompressor::compressStream(ByteSource& in, BitWriter& out) {
+    StageScope stage(Stage::Code);
+    TraceScope trace("compressStream", "lzw");
+    uint64_t start_bits = out.getBitsWritten();
+    beginStream();
 
-    bool result = compressStream(temp_in, out);
-    temp_in.close();
+    // 管道等无法映射的输入：按 1MB 分块读取
+    std::vector<uint8_t> chunk(1 << 20);
+    for (;;) {
+        size_t got = in.read(chunk.data(), chunk.size());
+        if (got == 0) break;
+        if (!compressChunk(chunk.data(), got, out)) {
+            return false;
+        }
+    }
 
-    // ʱļ
-    std::remove(temp_filename.c_str());
+    if (!finishStream(out)) {
+        return false;
+    }
+    stage.addBytes(input_size_, (out.getBitsWritten() - start_bits) / 8);
+    trace.setBytes(input_size_);
+    publishStats(out, start_bits);
+    return true;
+}
 
-    return result;
+bool LZWCompressor::compressString(const std::string& input, BitWriter& out) {
+    return compressBuffer(reinterpret_cast<const uint8_t*>(input.data()), input.size(), out);
 }
\ No newline at end of file
@@ -2,16 +2,27 @@
 #define LZW_COMPRESS_H
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include <fstream>
+#include <cstdint>
 #include "bitio.h"
+#include "stats.h"
 
-// LZW ѹѡ
+// 字典写满后的处理方式
+enum class LZWResetMode {
+    Freeze,     // 冻结字典，不再添加条目
+    OnFull,     // 写满立即发送清空代码
+    Adaptive    // 监视压缩率，下降超过阈值时发送清空代码（同 compress(1)）
+};
+
+// LZW 压缩器选项
 struct LZWCompressOptions {
-    int initial_code_width = 9;    // ʼ
-    int max_code_width = 12;       // 
-    bool use_clear_code = true;    // Ƿʹմ
+    int initial_code_width = 9;    // 初始码宽
+    int max_code_width = 12;       // 最大码宽（9-20）
+    bool use_clear_code = true;    // 是否使用清空代码
+    LZWResetMode reset_mode = LZWResetMode::Adaptive;
+    uint32_t ratio_window = 64 * 1024;  // 字典满后每隔多少输入字节检查一次压缩率
+    double ratio_threshold = 0.10;      // 窗口压缩率低于满后最佳值的比例超过该值时重置
 
     LZWCompressOptions() = default;
     LZWCompressOptions(int init_width, int max_width)
@@ -19,50 +30,142 @@ struct LZWCompressOptions {
     }
 };
 
-// LZW ѹ
+// 编码字典：以 (前缀码, 下一字节) 为键的开放寻址哈希表
+// 键 = (prefix << 8 | byte) + 1，槽位打包为 (键 << 32 | 码)，0 表示空槽
+// 表从初始码宽对应的大小开始，条目增多时成倍扩容，最大不超过最大码宽的两倍条目数
+class LZWEncoderTable {
+public:
+    static const uint32_t NOT_FOUND = 0xFFFFFFFF;
+
+    LZWEncoderTable(int initial_code_width, int max_code_width);
+
+    // 清空所有条目并缩回初始大小
+    void clear();
+
+    // 查找 (prefix, byte)，未找到时返回 NOT_FOUND，slot 为可插入的位置
+    // probes 累加检查过的非空槽位数（调用方的局部变量，统计关闭时被优化掉）
+    uint32_t find(uint32_t prefix, uint8_t byte, size_t& slot, uint64_t& probes) const {
+        uint64_t key = makeKey(prefix, byte);
+        size_t i = hash(key);
+        while (slots_[i] != 0) {
+            ++probes;
+            if ((slots_[i] >> 32) == key) {
+                slot = i;
+                return static_cast<uint32_t>(slots_[i]);
+            }
+            i = (i + 1) & mask_;
+        }
+        slot = i;
+        return NOT_FOUND;
+    }
+
+    // 在 find 返回的空槽位置插入新条目
+    void insertAt(size_t slot, uint32_t prefix, uint8_t byte, uint32_t code) {
+        slots_[slot] = (makeKey(prefix, byte) << 32) | code;
+        // 装载因子超过 1/2 时扩容（插入后 slot 失效）
+        if (++count_ * 2 > slots_.size() && slots_.size() < max_slots_) {
+            grow();
+        }
+    }
+
+    // 当前占用的内存（字节）
+    size_t memoryUsage() const { return slots_.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> slots_;
+    size_t mask_;
+    int shift_;
+    size_t count_;
+    size_t initial_slots_;
+    size_t max_slots_;
+
+    void resize(size_t slot_count);
+    void grow();
+
+    static uint64_t makeKey(uint32_t prefix, uint8_t byte) {
+        return ((static_cast<uint64_t>(prefix) << 8) | byte) + 1;
+    }
+
+    size_t hash(uint64_t key) const {
+        return static_cast<size_t>((static_cast<uint32_t>(key) * 0x9E3779B1u) >> shift_) & mask_;
+    }
+};
+
+// LZW 压缩器
 class LZWCompressor {
 public:
     explicit LZWCompressor(const LZWCompressOptions& options = LZWCompressOptions());
 
-    // ѹ
+    // 压缩数据流（按大块读取后交给 compressChunk）
     bool compressStream(std::ifstream& in, BitWriter& out);
+    bool compressStream(ByteSource& in, BitWriter& out);
 
-    // ѹַڲԣ
+    // 压缩一段连续内存（例如 mmap 映射的整个文件）
+    bool compressBuffer(const uint8_t* data, size_t size, BitWriter& out);
+
+    // 分块压缩接口：beginStream -> 多次 compressChunk -> finishStream
+    void beginStream();
+    bool compressChunk(const uint8_t* data, size_t size, BitWriter& out);
+    bool finishStream(BitWriter& out);
+
+    // 压缩字符串（用于测试）
     bool compressString(const std::string& input, BitWriter& out);
 
-    // ȡͳϢ
+    // 获取统计信息
     size_t getInputSize() const { return input_size_; }
     size_t getDictSize() const { return dict_size_; }
     size_t getCodesWritten() const { return codes_written_; }
+    size_t getResetCount() const { return reset_count_; }
+    const LZWCompressOptions& getOptions() const { return options_; }
+    size_t getDictMemory() const { return dictionary_.memoryUsage(); }
 
 private:
     LZWCompressOptions options_;
-    std::unordered_map<std::string,uint32_t> dictionary_;
+    LZWEncoderTable dictionary_;
+    uint32_t current_;          // 跨块保留的当前序列码
     uint32_t next_code_;
     int current_code_width_;
     size_t input_size_;
     size_t dict_size_;
     size_t codes_written_;
+    size_t reset_count_;
+
+    // 自适应重置的滑动窗口状态（字典写满后才开始）
+    bool window_active_;
+    uint64_t window_start_input_;
+    uint64_t window_start_bits_;
+    double best_ratio_;
 
-    // 
+#if LZW_ENABLE_STATS
+    CoderCounters stats_;
+    uint64_t fill_start_ = 0;   // 本轮字典开始填充的时刻
+#endif
+
+    // 特殊代码
     static const uint32_t CLEAR_CODE = 256;
     static const uint32_t EOF_CODE = 257;
     static const uint32_t FIRST_CODE = 258;
 
-    // ʼֵ
+    // 初始化字典
     void initDictionary();
 
-    // ֵ
+    // 清空字典
     void clearDictionary();
 
-    // ǷҪ
+    // 检查是否需要增加码宽
     bool shouldIncreaseCodeWidth() const;
 
-    // ֵǷ
+    // 检查字典是否已满
     bool isDictionaryFull() const;
 
-    // д
+    // 字典已满时判断是否应当重置（input_pos 为当前输入位置）
+    bool shouldReset(uint64_t input_pos, const BitWriter& out);
+
+    // 写入代码
     bool writeCode(BitWriter& out, uint32_t code);
+
+    // 把本码流的计数并入全局统计（start_bits 为码流开始时 out 已写入的位数）
+    void publishStats(const BitWriter& out, uint64_t start_bits);
 };
 
 #endif 
\ No newline at end of file
@@ -1,21 +1,30 @@
 #include "lzw_decompress.h"
+#include "stats.h"
+#include "trace.h"
 #include <iostream>
-#include<sstream>
 
 LZWDecompressor::LZWDecompressor(const LZWDecompressOptions& options)
     : options_(options), next_code_(FIRST_CODE),
     current_code_width_(options.initial_code_width),
-    output_size_(0), dict_size_(0), codes_read_(0) {
+    output_size_(0), dict_size_(0), codes_read_(0), out_pos_(0) {
     initDictionary();
 }
 
 void LZWDecompressor::initDictionary() {
-    dictionary_.clear();
-    dictionary_.resize(1 << options_.max_code_width);
+    // 数组从初始码宽对应的大小开始，随码宽增加扩容（见 growDictionary）
+    size_t capacity = size_t(1) << options_.initial_code_width;
+    if (prefix_.size() < capacity) {
+        prefix_.resize(capacity);
+        suffix_.resize(capacity);
+        first_.resize(capacity);
+        length_.resize(capacity);
+    }
 
-    // еַֽ (0-255)
-    for (int i = 0; i < 256; ++i) {
-        dictionary_[i] = std::string(1, static_cast<char>(i));
+    // 添加所有单字节字符 (0-255)
+    for (uint32_t i = 0; i < 256; ++i) {
+        suffix_[i] = static_cast<uint8_t>(i);
+        first_[i] = static_cast<uint8_t>(i);
+        length_[i] = 1;
     }
 
     next_code_ = FIRST_CODE;
@@ -28,7 +37,8 @@ void LZWDecompressor::clearDictionary() {
 }
 
 bool LZWDecompressor::shouldIncreaseCodeWidth() const {
-    return next_code_ >= (1U << current_code_width_) &&
+    // 解码端的字典比编码端晚一个条目，因此要提前一个码切换码宽
+    return next_code_ + 1 >= (1U << current_code_width_) &&
         current_code_width_ < options_.max_code_width;
 }
 
@@ -41,98 +51,145 @@ bool LZWDecompressor::readCode(BitReader& in, uint32_t& code) {
     return in.read(code, current_code_width_);
 }
 
-std::string LZWDecompressor::getDictEntry(uint32_t code, const std::string& prev_string) const {
-    if (code < next_code_) {
-        return dictionary_[code];
+void LZWDecompressor::growDictionary() {
+    size_t capacity = prefix_.size() * 2;
+    size_t max_capacity = size_t(1) << options_.max_code_width;
+    if (capacity > max_capacity) capacity = max_capacity;
+    prefix_.resize(capacity);
+    suffix_.resize(capacity);
+    first_.resize(capacity);
+    length_.resize(capacity);
+}
+
+bool LZWDecompressor::flushOutput(ByteSink& out) {
+    if (out_pos_ > 0) {
+        if (!out.write(out_buf_.data(), out_pos_)) return false;
+        out_pos_ = 0;
     }
-    else if (code == next_code_ && !prev_string.empty()) {
-        //  KwKwK ģʽ
-        return prev_string + prev_string[0];
+    return true;
+}
+
+bool LZWDecompressor::emitEntry(uint32_t code, ByteSink& out) {
+    uint32_t len = length_[code];
+    if (out_pos_ + len > out_buf_.size()) {
+        if (!flushOutput(out)) return false;
+        if (len > out_buf_.size()) {
+            out_buf_.resize(len);
+        }
     }
-    else {
-        // Ч
-        return "";
+
+    // 沿前缀链从末字节向前写入
+    uint8_t* p = out_buf_.data() + out_pos_ + len - 1;
+    while (code >= 256) {
+        *p-- = suffix_[code];
+        code = prefix_[code];
     }
+    *p = static_cast<uint8_t>(code);
+
+    out_pos_ += len;
+    output_size_ += len;
+    return true;
 }
 
 bool LZWDecompressor::decompressStream(BitReader& in, std::ofstream& out) {
     if (!out.good()) return false;
+    StreamByteSink sink(out);
+    return decompressStream(in, sink) && sink.flush();
+}
 
+bool LZWDecompressor::decompressStream(BitReader& in, ByteSink& out) {
+    StageScope stage(Stage::Code);
+    TraceScope trace("decompressStream", "lzw");
+    uint64_t start_bits = in.getBitsRead();
+#if LZW_ENABLE_STATS
+    CoderCounters stats;
+    uint64_t fill_start = statsNow();
+#endif
     initDictionary();
     output_size_ = 0;
     codes_read_ = 0;
+    out_buf_.resize(256 * 1024);
+    out_pos_ = 0;
 
+    const uint32_t NO_CODE = 0xFFFFFFFF;
     uint32_t code;
-    std::string prev_string;
+    uint32_t prev = NO_CODE;
 
     while (readCode(in, code)) {
         if (code == EOF_CODE) {
-            // ļĩβ
+            // 到达文件末尾
             break;
         }
 
         if (code == CLEAR_CODE && options_.use_clear_code) {
-            // ֵ
+            // 清空字典
             clearDictionary();
-            prev_string.clear();
+            prev = NO_CODE;
+            LZW_STAT(stats.resets++; fill_start = statsNow();
+                stats.addEvent(CoderEvent::Reset, current_code_width_, output_size_));
             continue;
         }
 
-        // ȡǰӦַ
-        std::string current_string = getDictEntry(code, prev_string);
-        if (current_string.empty()) {
+        // 合法的码：已有条目，或 KwKwK 模式下恰好等于下一个码
+        bool known = code < next_code_ && code != CLEAR_CODE && code != EOF_CODE;
+        bool kwkwk = code == next_code_ && prev != NO_CODE && !isDictionaryFull();
+        if (!known && !kwkwk) {
             std::cerr << "Error: invalid code " << code << std::endl;
             return false;
         }
 
-        // ǰַ
-        out.write(current_string.c_str(), current_string.length());
-        if (!out.good()) return false;
-        output_size_ += current_string.length();
-
-        // ǵһ룬Ŀֵ
-        if (!prev_string.empty() && !isDictionaryFull()) {
-            std::string new_entry = prev_string + current_string[0];
-            dictionary_[next_code_++] = new_entry;
+        // 如果不是第一个代码，先添加新条目（前一条目 + 当前条目首字节）
+        if (prev != NO_CODE && !isDictionaryFull()) {
+            uint32_t n = next_code_++;
+            if (n >= prefix_.size()) {
+                growDictionary();
+            }
+            prefix_[n] = prev;
+            suffix_[n] = kwkwk ? first_[prev] : first_[code];
+            first_[n] = first_[prev];
+            length_[n] = length_[prev] + 1;
             dict_size_++;
 
-            // ǷҪ
+            // 检查是否需要增加码宽
             if (shouldIncreaseCodeWidth()) {
                 current_code_width_++;
+                LZW_STAT(stats.width_changes++;
+                    stats.addEvent(CoderEvent::Widen, current_code_width_, output_size_));
             }
+#if LZW_ENABLE_STATS
+            if (isDictionaryFull()) {
+                stats.dictionary_fills++;
+                stats.fill_nanoseconds += statsNow() - fill_start;
+                stats.addEvent(CoderEvent::Full, current_code_width_, output_size_);
+            }
+#endif
         }
 
-        prev_string = current_string;
+        // 输出当前条目
+        if (!emitEntry(code, out)) return false;
+
+        prev = code;
     }
 
+    if (!flushOutput(out)) return false;
+
+    uint64_t input_bytes = (in.getBitsRead() - start_bits + 7) / 8;
+    stage.addBytes(input_bytes, output_size_);
+    trace.setBytes(output_size_);
+#if LZW_ENABLE_STATS
+    stats.streams = 1;
+    stats.input_bytes = input_bytes;
+    stats.output_bytes = output_size_;
+    stats.codes = codes_read_;
+    statsAddDecoder(stats);
+#endif
     return true;
 }
 
 bool LZWDecompressor::decompressToString(BitReader& in, std::string& output) {
-    output.clear();
-
-    std::string temp_filename = "/tmp/lzw_decomp_" + std::to_string(reinterpret_cast<uintptr_t>(this));
-    std::ofstream temp_out(temp_filename, std::ios::binary);
-    if (!temp_out) return false;
-
-    bool result = decompressStream(in, temp_out);
-    temp_out.close();
-
-    if (result) {
-        std::ifstream temp_in(temp_filename, std::ios::binary);
-        if (temp_in) {
-            std::ostringstream oss;
-            oss << temp_in.rdbuf();
-            output = oss.str();
-            temp_in.close();
-        }
-        else {
-            result = false;
-        }
-    }
-
-    // ʱļ
-    std::remove(temp_filename.c_str());
-
+    std::vector<uint8_t> buffer;
+    MemoryByteSink sink(buffer);
+    bool result = decompressStream(in, sink);
+    output.assign(buffer.begin(), buffer.end());
     return result;
 }
\ No newline at end of file
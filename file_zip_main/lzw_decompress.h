@@ -4,12 +4,13 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <cstdint>
 #include "bitio.h"
 
-// LZW ѹѡ
+// LZW 解压器选项
 struct LZWDecompressOptions {
     int initial_code_width = 9;
-    int max_code_width = 12;
+    int max_code_width = 12;       // 9-20
     bool use_clear_code = true;
 
     LZWDecompressOptions() = default;
@@ -17,53 +18,68 @@ struct LZWDecompressOptions {
         : initial_code_width(init_width), max_code_width(max_width) {}
 };
 
-// LZW ѹ
+// LZW 解压器
 class LZWDecompressor {
 public:
     explicit LZWDecompressor(const LZWDecompressOptions& options = LZWDecompressOptions());
 
-    // ѹ
+    // 解压数据流
     bool decompressStream(BitReader& in, std::ofstream& out);
 
-    // ѹַڲԣ
+    // 解压到任意输出端（解码结果先写入内部输出块，写满后整块交出）
+    bool decompressStream(BitReader& in, ByteSink& out);
+
+    // 解压到字符串（用于测试）
     bool decompressToString(BitReader& in, std::string& output);
 
-    // ȡͳϢ
+    // 获取统计信息
     size_t getOutputSize() const { return output_size_; }
     size_t getDictSize() const { return dict_size_; }
     size_t getCodesRead() const { return codes_read_; }
 
 private:
     LZWDecompressOptions options_;
-    std::vector<std::string> dictionary_;
+    // 字典以并列数组保存：条目 = 前缀条目 + 末字节
+    std::vector<uint32_t> prefix_;  // 前缀码
+    std::vector<uint8_t> suffix_;   // 末字节
+    std::vector<uint8_t> first_;    // 首字节（用于 KwKwK 和新条目）
+    std::vector<uint32_t> length_;  // 条目长度
     uint32_t next_code_;
     int current_code_width_;
     size_t output_size_;
     size_t dict_size_;
     size_t codes_read_;
+    std::vector<uint8_t> out_buf_;  // 输出块
+    size_t out_pos_;                // 输出块中已填充的字节数
 
-    // 
+    // 特殊代码
     static const uint32_t CLEAR_CODE = 256;
     static const uint32_t EOF_CODE = 257;
     static const uint32_t FIRST_CODE = 258;
 
-    // ʼֵ
+    // 初始化字典
     void initDictionary();
 
-    // ֵ
+    // 清空字典
     void clearDictionary();
 
-    // ǷҪ
+    // 检查是否需要增加码宽
     bool shouldIncreaseCodeWidth() const;
 
-    // ֵǷ
+    // 检查字典是否已满
     bool isDictionaryFull() const;
 
-    // ȡ
+    // 读取代码
     bool readCode(BitReader& in, uint32_t& code);
 
-    // ȡֵĿ
-    std::string getDictEntry(uint32_t code, const std::string& prev_string) const;
+    // 字典数组扩容一倍（不超过最大码宽）
+    void growDictionary();
+
+    // 把条目从末字节向前直接写入输出块
+    bool emitEntry(uint32_t code, ByteSink& out);
+
+    // 把输出块交给输出端
+    bool flushOutput(ByteSink& out);
 };
 
 #endif 
\ No newline at end of file
@@ -1,25 +1,86 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <climits>
 #include <fstream>
 #include <chrono>
+#include <thread>
 #include "fileio.h"
 #include "format.h"
 #include "preprocess.h"
 #include "bitio.h"
 #include "lzw_compress.h"
 #include "lzw_decompress.h"
+#include "block_archive.h"
+#include "pipeline.h"
+#include "columnar.h"
+#include "multi_archive.h"
+#include "checksum.h"
+#include "stats.h"
+#include "trace.h"
+
+// ѹ
+struct CompressSettings {
+    int max_code_width = 12;   // --max-bits
+    int threads = 1;           // --threads
+    int member_threads = 0;    // ѹĿ¼ʱͬʱļ--threads0 ʾʹȫӲ߳
+    uint32_t block_size = 0;   // --block-sizeֽڣ0 ʾһ
+    bool pipeline = false;     // --pipeline롢дֱ߳
+    FileBackend io = FileBackend::Auto;  // --io
+    bool preprocess = false;   // --preprocessѹǰ滻ʽԤ
+    bool train_table = false;  // --train-tableвѵ滻 --preprocess
+    bool columnar = false;     // --columnarW3C ־ #Fields Уеѹ
+};
+
+// ѹ
+struct DecompressSettings {
+    int threads = 0;           // --threads0 ʾʹȫӲ߳
+    bool has_range = false;    // Ƿֻȡһ
+    uint64_t offset = 0;       // --offset
+    uint64_t length = UINT64_MAX; // --lengthĬϵĩβ
+    bool pipeline = false;     // --pipeline
+    FileBackend io = FileBackend::Auto;  // --io
+    std::string member;        // --memberֻѹļ鵵еһԱ
+};
 
 // Parsed args ṹ
 struct ParsedArgs {
     std::string src;
     std::string dst;
     std::string mode; // "zip" or "unzip"
+    CompressSettings zip;
+    DecompressSettings unzip;
+    bool stats_json = false; // --stats=jsonͳ JSON  stdoutֱĵ stderr
+    std::string trace_path;  // --traceʱдļChrome trace-event ʽ
 };
 
 // ӡ÷
 void printUsage(const char* prog) {
-    std::cerr << "Usage: " << prog << " {src} {dst} {zip|unzip}\n";
+    std::cerr << "Usage: " << prog << " {src} {dst} {zip|unzip} [options]\n"
+        << "  zip of a directory {src} writes a multi-file archive; unzip of one writes into directory {dst}\n"
+        << "  '-' as {src} or {dst} reads stdin or writes stdout (streaming; POSIX only)\n"
+        << "Options (zip):\n"
+        << "  --max-bits N    maximum code width, " << ArchiveHeader::MIN_CODE_WIDTH
+        << "-" << ArchiveHeader::MAX_CODE_WIDTH << " (default 12)\n"
+        << "  --threads N     compress independent blocks on N threads (v2 archive),\n"
+        << "                  or N files at a time when {src} is a directory (default: all cores)\n"
+        << "  --block-size M  block size in MB, 1-256 (default 8 when --threads > 1)\n"
+        << "  --pipeline      overlap reading, coding and writing on three threads\n"
+        << "  --preprocess    replace frequent log substrings with short tokens before LZW\n"
+        << "  --train-table   build the replacement table from a sample of the input (implies --preprocess)\n"
+        << "  --columnar      split W3C log records into per-field columns compressed separately\n"
+        << "                  (--threads compresses columns in parallel, --block-size sets the chunk size)\n"
+        << "Options (unzip):\n"
+        << "  --threads N     decode blocks of a v2 archive on N threads (default: all cores)\n"
+        << "  --offset X      extract only the original bytes starting at X\n"
+        << "  --length N      extract at most N bytes (default: to the end)\n"
+        << "  --member NAME   extract only the file NAME of a multi-file archive to {dst}\n"
+        << "  --pipeline      overlap reading, decoding and writing on three threads\n"
+        << "Options (both):\n"
+        << "  --io BACKEND    file I/O backend: auto, mmap, pread or uring (default auto)\n"
+        << "  --stats=json    print per-stage timings and coder counters as JSON on stdout\n"
+        << "  --trace FILE    write a Chrome/Perfetto trace-event timeline of the run to FILE\n";
 }
 
 // ļǷڣԶƴ򿪣
@@ -28,11 +89,35 @@ bool fileExists(const std::string& path) {
     return in.good();
 }
 
+// ʧʱɾļд׼ʱļɾ
+void removeOutput(const std::string& path) {
+    if (!isStandardStream(path)) {
+        std::remove(path.c_str());
+    }
+}
+
+// ѡֵ鷶Χ
+bool parseIntOption(int argc, char* argv[], int& i, long long min_v, long long max_v, long long& out) {
+    std::string name = argv[i];
+    if (i + 1 >= argc) {
+        std::cerr << "Error: option " << name << " requires a value\n";
+        return false;
+    }
+    char* end = nullptr;
+    long long v = std::strtoll(argv[++i], &end, 10);
+    if (end == argv[i] || *end != '\0' || v < min_v || v > max_v) {
+        std::cerr << "Error: " << name << " must be an integer in [" << min_v << ", " << max_v << "]\n";
+        return false;
+    }
+    out = v;
+    return true;
+}
+
 // вУ
 bool parseArgs(int argc, char* argv[], ParsedArgs& parsedArgs) {
-    if (argc != 4) {
+    if (argc < 4) {
         printUsage(argv[0]);
-        std::cerr << "Error: expected 3 parameters, got " << (argc - 1) << "\n";
+        std::cerr << "Error: expected at least 3 parameters, got " << (argc - 1) << "\n";
         return false;
     }
     parsedArgs.src = argv[1];
@@ -44,7 +129,101 @@ bool parseArgs(int argc, char* argv[], ParsedArgs& parsedArgs) {
         return false;
     }
 
-    if (!fileExists(parsedArgs.src)) {
+    for (int i = 4; i < argc; ++i) {
+        std::string opt = argv[i];
+        long long v = 0;
+        if (opt == "--max-bits") {
+            if (!parseIntOption(argc, argv, i, ArchiveHeader::MIN_CODE_WIDTH, ArchiveHeader::MAX_CODE_WIDTH, v)) return false;
+            parsedArgs.zip.max_code_width = static_cast<int>(v);
+        }
+        else if (opt == "--threads") {
+            if (!parseIntOption(argc, argv, i, 1, 256, v)) return false;
+            parsedArgs.zip.threads = static_cast<int>(v);
+            parsedArgs.zip.member_threads = static_cast<int>(v);
+            parsedArgs.unzip.threads = static_cast<int>(v);
+        }
+        else if (opt == "--offset" || opt == "--length") {
+            if (!parseIntOption(argc, argv, i, 0, LLONG_MAX, v)) return false;
+            parsedArgs.unzip.has_range = true;
+            if (opt == "--offset") {
+                parsedArgs.unzip.offset = static_cast<uint64_t>(v);
+            }
+            else {
+                parsedArgs.unzip.length = static_cast<uint64_t>(v);
+            }
+        }
+        else if (opt == "--member") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: option --member requires a file name\n";
+                return false;
+            }
+            parsedArgs.unzip.member = argv[++i];
+        }
+        else if (opt == "--pipeline") {
+            parsedArgs.zip.pipeline = true;
+            parsedArgs.unzip.pipeline = true;
+        }
+        else if (opt == "--preprocess") {
+            parsedArgs.zip.preprocess = true;
+        }
+        else if (opt == "--train-table") {
+            parsedArgs.zip.train_table = true;
+            parsedArgs.zip.preprocess = true;
+        }
+        else if (opt == "--columnar") {
+            parsedArgs.zip.columnar = true;
+        }
+        else if (opt == "--io") {
+            FileBackend backend;
+            if (i + 1 >= argc || !parseFileBackend(argv[i + 1], backend)) {
+                std::cerr << "Error: --io must be one of auto, mmap, pread, uring\n";
+                return false;
+            }
+            ++i;
+            parsedArgs.zip.io = backend;
+            parsedArgs.unzip.io = backend;
+        }
+        else if (opt.compare(0, 8, "--stats=") == 0) {
+            if (opt != "--stats=json") {
+                std::cerr << "Error: --stats only supports json\n";
+                return false;
+            }
+            parsedArgs.stats_json = true;
+        }
+        else if (opt == "--trace") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: option --trace requires a file name\n";
+                return false;
+            }
+            parsedArgs.trace_path = argv[++i];
+        }
+        else if (opt == "--block-size") {
+            if (!parseIntOption(argc, argv, i, 1, 256, v)) return false;
+            parsedArgs.zip.block_size = static_cast<uint32_t>(v) * 1024 * 1024;
+        }
+        else {
+            printUsage(argv[0]);
+            std::cerr << "Error: unknown option '" << opt << "'\n";
+            return false;
+        }
+    }
+
+    if (parsedArgs.zip.threads > 1 && parsedArgs.zip.block_size == 0 && !parsedArgs.zip.columnar) {
+        parsedArgs.zip.block_size = BlockCompressOptions().block_size;
+    }
+
+    if (parsedArgs.unzip.has_range && !parsedArgs.unzip.member.empty()) {
+        std::cerr << "Error: --member cannot be combined with --offset/--length\n";
+        return false;
+    }
+
+    // ֻѹʱԴĿ¼
+    bool directory = isDirectory(parsedArgs.src);
+    if (directory && parsedArgs.mode != "zip") {
+        std::cerr << "Error: source '" << parsedArgs.src << "' is a directory\n";
+        return false;
+    }
+    if (!directory && !isStandardStream(parsedArgs.src) && !fileExists(parsedArgs.src)) {
         std::cerr << "Error: source file '" << parsedArgs.src << "' does not exist or cannot be opened.\n";
         return false;
     }
@@ -52,60 +231,375 @@ bool parseArgs(int argc, char* argv[], ParsedArgs& parsedArgs) {
     return true;
 }
 
+// ѵļоȡƬΣڵʱ仯Ҳܲɵ
+bool readTrainingSample(BufferedFileReader& file, std::vector<std::string>& samples) {
+    const uint64_t slice_count = 16;
+    const uint64_t slice_size = 128 * 1024;
+    if (!file.sizeKnown()) return false;
+
+    uint64_t size = file.fileSize();
+    if (size <= slice_count * slice_size) {
+        samples.assign(1, std::string(static_cast<size_t>(size), '\0'));
+        return size == 0 || file.readAt(0, &samples[0][0], static_cast<size_t>(size));
+    }
+
+    samples.assign(slice_count, std::string(static_cast<size_t>(slice_size), '\0'));
+    for (uint64_t i = 0; i < slice_count; ++i) {
+        uint64_t offset = (size - slice_size) * i / (slice_count - 1);
+        if (!file.readAt(offset, &samples[i][0], static_cast<size_t>(slice_size))) return false;
+    }
+    return true;
+}
+
 // ѹ
-bool compressFile(const std::string& src_path, const std::string& dst_path) {
+bool compressFile(const std::string& src_path, const std::string& dst_path, const CompressSettings& settings, RunInfo& run) {
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    // 1. ȡļСȡȫ
-    std::ifstream src_file(src_path, std::ios::binary);
-    if (!src_file) {
+    // 1. Դļͨļӳ䵽ڴ棬ܵ˻ش󻺳˳ȡ
+    //    ˮģʽɶ߳˳ȡ
+    bool columnar = settings.columnar;
+    bool pipelined = settings.pipeline && (settings.block_size == 0 || columnar);
+    FileBackend read_backend = settings.io;
+    if (read_backend == FileBackend::Auto && pipelined) {
+        read_backend = FileBackend::Pread;
+    }
+    BufferedFileReader src_file;
+    if (!src_file.open(src_path, BufferedFileReader::DEFAULT_BUFFER_SIZE, read_backend)) {
         std::cerr << "Error: cannot open source file for reading\n";
         return false;
     }
+    // ܵȴСδ֪룺header бǴСδ֪ԭʼС CRC-32 д֮β
+    // ݱѹдҪȰ
+    bool size_known = src_file.sizeKnown();
+    uint64_t original_size = src_file.fileSize();
+
+    if (size_known) {
+        std::cout << "Original size: " << original_size << " bytes\n";
+    }
+    else {
+        std::cout << "Original size: unknown (streaming input, size and CRC-32 go in the trailer)\n";
+    }
+
+    // 2. дͷҪʱԤ
+    BufferedFileWriter dst_file;
+    if (!dst_file.open(dst_path, BufferedFileWriter::DEFAULT_BUFFER_SIZE, settings.io)) {
+        std::cerr << "Error: cannot open destination file for writing\n";
+        return false;
+    }
+
+    // ֿʽҪԴݣ¼ԭʼСԤС䣬ֻõһ
+    bool blocked = settings.block_size > 0 && !columnar;
+    if (blocked && src_file.backend() != FileBackend::Mmap) {
+        std::cerr << "Warning: block mode needs a memory-mapped regular file, falling back to a single stream\n";
+        blocked = false;
+    }
+    if (blocked && settings.preprocess) {
+        std::cerr << "Warning: --preprocess writes a single stream, ignoring --threads/--block-size\n";
+        blocked = false;
+    }
+    // Ҫڸд׼ܻ
+    if (blocked && isStandardStream(dst_path)) {
+        std::cerr << "Warning: block mode cannot backfill its table on stdout, falling back to a single stream\n";
+        blocked = false;
+    }
+
+    // ʽʽֶβԭʼ־پ滻
+    if (columnar && settings.preprocess) {
+        std::cerr << "Warning: --columnar ignores --preprocess/--train-table\n";
+    }
+
+    ArchiveHeader header;
+    header.original_size = original_size;
+    header.setPreprocessing(settings.preprocess && !columnar);
+    header.setSizeUnknown(!size_known);
+    header.max_code_width = static_cast<uint16_t>(settings.max_code_width);
+    if (blocked) {
+        header.version = ArchiveHeader::VERSION_BLOCKED;
+        header.block_size = settings.block_size;
+        header.block_count = blockCountFor(original_size, settings.block_size);
+    }
+    else if (columnar) {
+        header.version = ArchiveHeader::VERSION_COLUMNAR;
+        header.block_size = settings.block_size > 0 ? settings.block_size : ColumnarOptions().chunk_size;
+    }
+
+    run.archive_version = header.version;
+    run.max_code_width = header.max_code_width;
+    run.preprocessing = header.hasPreprocessing();
+    run.pipeline = pipelined;
+    run.threads = blocked || columnar ? settings.threads : 1;
+
+    if (!writeHeader(dst_file, header)) {
+        std::cerr << "Error: failed to write header\n";
+        return false;
+    }
+
+    preprocessor preprocessor;
+    if (settings.train_table && header.hasPreprocessing()) {
+        std::vector<std::string> samples;
+        if (!src_file.sizeKnown()) {
+            std::cerr << "Error: --train-table needs a regular file to sample\n";
+            return false;
+        }
+        if (!readTrainingSample(src_file, samples)) {
+            std::cerr << "Error: failed to read the training sample from the source file\n";
+            return false;
+        }
+        std::cout << "Trained table: " << preprocessor.train(samples) << " entries\n";
+    }
+    if (header.hasPreprocessing() && !preprocessor.serialize_table(dst_file)) {
+        std::cerr << "Error: failed to write preprocessing table\n";
+        return false;
+    }
+
+    // 3. LZW ѹҪʱȾʽԤ
+    LZWCompressor compressor(LZWCompressOptions(ArchiveHeader::MIN_CODE_WIDTH, settings.max_code_width));
+    run.ratio_window = compressor.getOptions().ratio_window;
+    run.ratio_threshold = compressor.getOptions().ratio_threshold;
+    uint64_t compressed_size = 0;
+    ColumnarStats columnar_stats;
+
+    // Сδ֪ʱ֮дβcounted ͳʵʶԭʼ
+    auto finishTrailer = [&](ByteSink& sink, const ChecksumByteSource& counted) {
+        if (!header.sizeUnknown()) return true;
+        original_size = counted.size();
+        ArchiveTrailer trailer;
+        trailer.original_size = counted.size();
+        trailer.crc32 = counted.crc();
+        return writeTrailer(sink, trailer);
+    };
+
+    if (blocked) {
+        // дռλд
+        std::vector<BlockEntry> table(header.block_count, BlockEntry{ 0, 0 });
+        uint64_t table_pos = dst_file.position();
+        writeBlockTable(dst_file, table);
+
+        BlockCompressOptions block_options;
+        block_options.lzw = compressor.getOptions();
+        block_options.block_size = settings.block_size;
+        block_options.threads = settings.threads;
+        if (!compressBlocks(src_file.mappedData(), original_size, block_options, dst_file, table)) {
+            std::cerr << "Error: LZW compression failed\n";
+            return false;
+        }
+
+        compressed_size = dst_file.position();
+        if (!dst_file.seek(table_pos) || !writeBlockTable(dst_file, table)) {
+            std::cerr << "Error: failed to write block table\n";
+            return false;
+        }
+    }
+    else if (columnar) {
+        ColumnarOptions columnar_options;
+        columnar_options.lzw = compressor.getOptions();
+        columnar_options.chunk_size = header.block_size;
+        columnar_options.threads = settings.threads;
+        auto encode = [&](ByteSource& source, ByteSink& sink) {
+            ChecksumByteSource counted(source);
+            ByteSource& input = header.sizeUnknown() ? static_cast<ByteSource&>(counted) : source;
+            return compressColumnar(input, sink, columnar_options, columnar_stats) && finishTrailer(sink, counted);
+        };
+
+        MemoryByteSource mapped_source(src_file.mappedData(), static_cast<size_t>(original_size));
+        bool compressed;
+        if (pipelined) {
+            compressed = runPipeline(src_file, dst_file, PipelineOptions(), encode);
+        }
+        else {
+            compressed = encode(src_file.backend() == FileBackend::Mmap ? static_cast<ByteSource&>(mapped_source) : src_file, dst_file);
+        }
+        if (!compressed) {
+            std::cerr << "Error: LZW compression failed\n";
+            return false;
+        }
+        compressed_size = dst_file.position();
+    }
+    else if (pipelined) {
+        bool compressed = runPipeline(src_file, dst_file, PipelineOptions(), [&](ByteSource& source, ByteSink& sink) {
+            BitWriter bit_writer(sink);
+            ChecksumByteSource counted(source);
+            ByteSource& raw = header.sizeUnknown() ? static_cast<ByteSource&>(counted) : source;
+            preprocess_source preprocessed(preprocessor, raw);
+            ByteSource& input = header.hasPreprocessing() ? static_cast<ByteSource&>(preprocessed) : raw;
+            return compressor.compressStream(input, bit_writer) && bit_writer.flush() && finishTrailer(sink, counted);
+        });
+        if (!compressed) {
+            std::cerr << "Error: LZW compression failed\n";
+            return false;
+        }
+        compressed_size = dst_file.position();
+    }
+    else {
+        BitWriter bit_writer(dst_file);
+        bool mapped = src_file.backend() == FileBackend::Mmap;
+        ChecksumByteSource counted(src_file);
+        ByteSource& raw = header.sizeUnknown() ? static_cast<ByteSource&>(counted) : src_file;
+        bool compressed;
+        if (header.hasPreprocessing()) {
+            MemoryByteSource mapped_source(src_file.mappedData(), static_cast<size_t>(original_size));
+            preprocess_source preprocessed(preprocessor, mapped ? static_cast<ByteSource&>(mapped_source) : raw);
+            compressed = compressor.compressStream(preprocessed, bit_writer);
+        }
+        else {
+            compressed = mapped
+                ? compressor.compressBuffer(src_file.mappedData(), static_cast<size_t>(original_size), bit_writer)
+                : compressor.compressStream(raw, bit_writer);
+        }
+        if (!compressed) {
+            std::cerr << "Error: LZW compression failed\n";
+            return false;
+        }
+
+        if (!bit_writer.flush() || !finishTrailer(dst_file, counted)) {
+            std::cerr << "Error: failed to write compressed data\n";
+            return false;
+        }
+        compressed_size = dst_file.position();
+    }
+
+    // ȡʱ read ͬ 0ѹᵱɣ£
+    // С֪ʱ˳ֽҲҪ header һ£ļѹб̻䳤
+    bool read_all = !src_file.failed() && (!size_known || blocked || src_file.backend() == FileBackend::Mmap
+        || src_file.position() == original_size);
+    if (!read_all) {
+        std::cerr << "Error: failed to read the whole source file\n";
+        return false;
+    }
+    src_file.close();
+
+    // 4. 
+    if (!dst_file.close()) {
+        std::cerr << "Error: failed to write compressed data\n";
+        return false;
+    }
+
+    double compression_ratio = static_cast<double>(compressed_size) / static_cast<double>(original_size);
+    run.original_size = original_size;
+    run.compressed_size = compressed_size;
+    run.read_backend = fileBackendName(src_file.backend());
+    run.write_backend = fileBackendName(dst_file.backend());
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    std::cout << "Compression complete!\n";
+    std::cout << "I/O: " << fileBackendName(src_file.backend()) << " read, "
+        << fileBackendName(dst_file.backend()) << " write\n";
+    if (!size_known) {
+        std::cout << "Streamed input: " << original_size << " bytes\n";
+    }
+    std::cout << "Compressed size: " << compressed_size << " bytes\n";
+    std::cout << "Compression ratio: " << (compression_ratio * 100) << "%\n";
+    std::cout << "Time taken: " << duration.count() << " ms\n";
+    if (pipelined) {
+        std::cout << "Pipeline: reader, coder and writer threads\n";
+    }
+    if (blocked) {
+        std::cout << "Blocks: " << header.block_count << " x " << header.block_size
+            << " bytes on " << settings.threads << " thread(s)\n";
+    }
+    else if (columnar) {
+        std::cout << "Columnar: " << columnar_stats.chunks << " chunk(s), " << columnar_stats.records
+            << " records, " << columnar_stats.raw_lines << " other lines, " << settings.threads << " thread(s)\n";
+        std::cout << "Encoded size: " << columnar_stats.encoded_size << " bytes\n";
+    }
+    else {
+        if (header.hasPreprocessing()) {
+            std::cout << "Preprocessed size: " << compressor.getInputSize() << " bytes\n";
+        }
+        std::cout << "Dictionary resets: " << compressor.getResetCount()
+            << " (window=" << compressor.getOptions().ratio_window
+            << " bytes, threshold=" << compressor.getOptions().ratio_threshold * 100 << "%)\n";
+    }
+
+    return compression_ratio < 0.8;
+}
 
-    src_file.seekg(0, std::ios::end);
-    uint64_t original_size = static_cast<uint64_t>(src_file.tellg());
-    src_file.seekg(0, std::ios::beg);
+// Ŀ¼ѹĿ¼µÿļΪļ鵵еһԱ
+bool compressDirectory(const std::string& src_dir, const std::string& dst_path, const CompressSettings& settings, RunInfo& run) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // 1. гԱ
+    std::vector<MemberEntry> members;
+    if (!listMembers(src_dir, members)) {
+        return false;
+    }
+    uint64_t original_size = 0;
+    for (const auto& m : members) {
+        original_size += m.original_size;
+    }
+    run.original_size = original_size;
 
-    // 2. Ԥʱٶ
+    std::cout << "Members: " << members.size() << " file(s)\n";
     std::cout << "Original size: " << original_size << " bytes\n";
 
-    // 3. дͷʹԤ
-    std::ofstream dst_file(dst_path, std::ios::binary | std::ios::trunc);
-    if (!dst_file) {
+    // ÿԱһһ
+    if (settings.preprocess || settings.columnar || settings.pipeline) {
+        std::cerr << "Warning: directories are archived as one stream per file, ignoring --preprocess/--train-table/--columnar/--pipeline\n";
+    }
+
+    // 2. дͷռλĿ¼Ŀ¼Ҫд׼
+    if (isStandardStream(dst_path)) {
+        std::cerr << "Error: a multi-file archive must be written to a regular file\n";
+        return false;
+    }
+    BufferedFileWriter dst_file;
+    if (!dst_file.open(dst_path, BufferedFileWriter::DEFAULT_BUFFER_SIZE, settings.io)) {
         std::cerr << "Error: cannot open destination file for writing\n";
         return false;
     }
 
     ArchiveHeader header;
+    header.version = ArchiveHeader::VERSION_MULTI;
     header.original_size = original_size;
-    header.setPreprocessing(false);  // Ԥ
-    header.max_code_width = 12;
+    header.max_code_width = static_cast<uint16_t>(settings.max_code_width);
+    header.block_count = static_cast<uint32_t>(members.size());
+
+    int threads = settings.member_threads > 0 ? settings.member_threads : static_cast<int>(std::thread::hardware_concurrency());
+    if (threads < 1) threads = 1;
+    run.archive_version = header.version;
+    run.max_code_width = header.max_code_width;
+    run.threads = threads;
 
     if (!writeHeader(dst_file, header)) {
         std::cerr << "Error: failed to write header\n";
         return false;
     }
+    uint64_t directory_pos = dst_file.position();
+    if (!writeMemberDirectory(dst_file, members)) {
+        std::cerr << "Error: failed to write member directory\n";
+        return false;
+    }
 
-    // 4. ֱ LZW ѹԤ
-    BitWriter bit_writer(dst_file);
-    LZWCompressor compressor(LZWCompressOptions(9, 12));
-
-    if (!compressor.compressStream(src_file, bit_writer)) {
+    // 3. ԱѹɺĿ¼
+    MultiCompressOptions options;
+    options.lzw = LZWCompressOptions(ArchiveHeader::MIN_CODE_WIDTH, settings.max_code_width);
+    run.ratio_window = options.lzw.ratio_window;
+    run.ratio_threshold = options.lzw.ratio_threshold;
+    options.threads = threads;
+    options.io = settings.io;
+    if (!compressMembers(src_dir, members, options, dst_file)) {
         std::cerr << "Error: LZW compression failed\n";
         return false;
     }
 
-    bit_writer.flush();
-    src_file.close();
-    dst_file.close();
+    uint64_t compressed_size = dst_file.position();
+    if (!dst_file.seek(directory_pos) || !writeMemberDirectory(dst_file, members)) {
+        std::cerr << "Error: failed to write member directory\n";
+        return false;
+    }
 
-    // 5. 
-    std::ifstream compressed_file(dst_path, std::ios::binary | std::ios::ate);
-    uint64_t compressed_size = static_cast<uint64_t>(compressed_file.tellg());
-    compressed_file.close();
+    // 4. 
+    if (!dst_file.close()) {
+        std::cerr << "Error: failed to write compressed data\n";
+        return false;
+    }
 
     double compression_ratio = static_cast<double>(compressed_size) / static_cast<double>(original_size);
+    run.compressed_size = compressed_size;
+    run.read_backend = fileBackendName(settings.io);
+    run.write_backend = fileBackendName(dst_file.backend());
 
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
@@ -114,113 +608,343 @@ bool compressFile(const std::string& src_path, const std::string& dst_path) {
     std::cout << "Compressed size: " << compressed_size << " bytes\n";
     std::cout << "Compression ratio: " << (compression_ratio * 100) << "%\n";
     std::cout << "Time taken: " << duration.count() << " ms\n";
+    std::cout << "Members: compressed " << threads << " at a time\n";
 
     return compression_ratio < 0.8;
 }
 
 // ѹ
-bool decompressFile(const std::string& src_path, const std::string& dst_path) {
+bool decompressFile(const std::string& src_path, const std::string& dst_path, const DecompressSettings& settings, RunInfo& run) {
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    // 1. ѹļȡͷ
-    std::ifstream src_file(src_path, std::ios::binary);
-    if (!src_file) {
+    // 1. ѹļˮģʽɶ߳˳ȡ
+    FileBackend read_backend = settings.io;
+    if (read_backend == FileBackend::Auto && settings.pipeline) {
+        read_backend = FileBackend::Pread;
+    }
+    BufferedFileReader src_file;
+    if (!src_file.open(src_path, BufferedFileReader::DEFAULT_BUFFER_SIZE, read_backend)) {
         std::cerr << "Error: cannot open compressed file for reading\n";
         return false;
     }
 
-    ArchiveHeader header;
-    if (!readHeader(src_file, header)) {
-        std::cerr << "Error: failed to read header\n";
+    // 2. ȡͷheaderԤڣֿʽ
+    ArchiveLayout layout;
+    if (!readArchiveLayout(src_file, layout)) {
         return false;
     }
+    const ArchiveHeader& header = layout.header;
+    const std::vector<BlockEntry>& table = layout.blocks;
+    preprocessor& preprocessor = layout.preprocessing;
 
-    if (!headerMagicOk(header)) {
-        std::cerr << "Error: invalid file format\n";
-        return false;
-    }
+    run.archive_version = header.version;
+    run.max_code_width = header.max_code_width;
+    run.preprocessing = header.hasPreprocessing();
+    run.original_size = header.original_size;
+    run.compressed_size = src_file.fileSize();
 
     std::cout << "Archive info: version=" << int(header.version)
-        << ", original_size=" << header.original_size
+        << ", original_size=";
+    if (header.sizeUnknown()) {
+        std::cout << "unknown (in trailer)";
+    }
+    else {
+        std::cout << header.original_size;
+    }
+    std::cout << ", max_code_width=" << header.max_code_width
         << ", has_preprocessing=" << header.hasPreprocessing() << "\n";
 
-    // 2. ȡԤڣ
-    preprocessor preprocessor;
-    if (header.hasPreprocessing()) {
-        if (!preprocessor.deserialize_table(src_file)) {
-            std::cerr << "Error: failed to read preprocessing table\n";
+    int threads = settings.threads > 0 ? settings.threads : static_cast<int>(std::thread::hardware_concurrency());
+    if (threads < 1) threads = 1;
+
+    // ļ鵵dst ΪĿ¼Աнѹɵļ
+    if (header.isMulti()) {
+        if (isStandardStream(dst_path)) {
+            std::cerr << "Error: a multi-file archive unpacks into a directory, use --member to write one file to stdout\n";
             return false;
         }
-    }
+        bool ok = decompressMembers(src_file, header, layout.members, dst_path, threads, settings.io);
+        src_file.close();
+        if (!ok) {
+            std::cerr << "Error: LZW decompression failed\n";
+            return false;
+        }
+
+        run.threads = threads;
+        run.read_backend = fileBackendName(src_file.backend());
+        run.write_backend = fileBackendName(settings.io);
 
-    // 3. LZW ѹ
-    BitReader bit_reader(src_file);
-    LZWDecompressor decompressor(LZWDecompressOptions(9, header.max_code_width));
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
 
-    // ʱļռѹ
-    std::string temp_file = dst_path + ".tmp";
-    std::ofstream temp_out(temp_file, std::ios::binary);
+        std::cout << "Decompression complete!\n";
+        std::cout << "Members: " << layout.members.size() << " file(s) decoded " << threads << " at a time\n";
+        std::cout << "Output size: " << header.original_size << " bytes\n";
+        std::cout << "Time taken: " << duration.count() << " ms\n";
+        return true;
+    }
 
-    if (!decompressor.decompressStream(bit_reader, temp_out)) {
+    // С֪ʱΪĿļԤռ
+    BufferedFileWriter dst_file;
+    if (!dst_file.open(dst_path, BufferedFileWriter::DEFAULT_BUFFER_SIZE, settings.io)) {
+        std::cerr << "Error: cannot open destination file for writing\n";
+        return false;
+    }
+    dst_file.preallocate(header.original_size);
+
+    LZWDecompressor decompressor(LZWDecompressOptions(ArchiveHeader::MIN_CODE_WIDTH, header.max_code_width));
+
+    bool ok;
+    uint64_t output_size = 0;
+    bool pipelined = false;
+    ArchiveTrailer trailer;
+    if (header.isBlocked() && !header.hasPreprocessing() && src_file.sizeKnown() && !isStandardStream(dst_path)) {
+        // 3a. ֿ鵵ԭʼС֪нλд루Ҫɶλ
+        ok = decompressBlocksParallel(src_file, layout.data_offset, header, table, dst_file, threads)
+            && dst_file.setSize(header.original_size);
+        output_size = ok ? header.original_size : 0;
+    }
+    else {
+        // 3b. LZW ѹндĿļҪʱʽָԤ
+        // Сδ֪Ĺ鵵֮β˶ʵĴС CRC-32
+        auto decode = [&](ByteSource& source, ByteSink& file_sink) {
+            ChecksumByteSink checked(file_sink);
+            ByteSink& output = header.sizeUnknown() ? static_cast<ByteSink&>(checked) : file_sink;
+            restore_sink restorer(preprocessor, output);
+            ByteSink& sink = header.hasPreprocessing() ? static_cast<ByteSink&>(restorer) : output;
+
+            bool decoded;
+            bool has_trailer = !header.sizeUnknown();
+            if (header.isColumnar()) {
+                decoded = decompressColumnar(source, header, sink, threads);
+                if (decoded && !has_trailer) {
+                    has_trailer = readTrailer(source, trailer);
+                }
+            }
+            else if (header.isBlocked()) {
+                decoded = decompressBlocks(source, header, table, sink);
+            }
+            else {
+                BitReader bit_reader(source);
+                decoded = decompressor.decompressStream(bit_reader, sink);
+                if (decoded && !has_trailer) {
+                    // βڲ뵽ֽڵ֮󣬿ѱ BitReader 
+                    uint8_t bytes[ArchiveTrailer::SIZE];
+                    MemoryByteSource trailer_source(bytes, sizeof(bytes));
+                    has_trailer = bit_reader.readAlignedBytes(bytes, sizeof(bytes)) && readTrailer(trailer_source, trailer);
+                }
+            }
+            if (decoded && !has_trailer) {
+                std::cerr << "Error: archive trailer is missing\n";
+                decoded = false;
+            }
+            if (decoded && header.hasPreprocessing()) {
+                decoded = restorer.finish();
+            }
+            if (decoded && header.sizeUnknown()
+                && (checked.size() != trailer.original_size || checked.crc() != trailer.crc32)) {
+                std::cerr << "Error: output does not match the archive trailer (size or CRC-32)\n";
+                decoded = false;
+            }
+            return decoded;
+        };
+
+        pipelined = settings.pipeline;
+        ok = pipelined ? runPipeline(src_file, dst_file, PipelineOptions(), decode) : decode(src_file, dst_file);
+        output_size = ok ? dst_file.position() : 0;
+    }
+    if (!src_file.sizeKnown()) {
+        run.compressed_size = src_file.position();
+    }
+    ok = dst_file.close() && ok;
+    src_file.close();
+
+    if (!ok) {
         std::cerr << "Error: LZW decompression failed\n";
-        temp_out.close();
-        src_file.close();
-        std::remove(temp_file.c_str());
+        removeOutput(dst_path);
         return false;
     }
 
-    temp_out.close();
-    src_file.close();
+    uint64_t expected_size = header.sizeUnknown() ? trailer.original_size : header.original_size;
+    run.original_size = expected_size;
+    run.threads = header.isBlocked() || header.isColumnar() ? threads : 1;
+    run.pipeline = pipelined;
+    run.read_backend = fileBackendName(src_file.backend());
+    run.write_backend = fileBackendName(dst_file.backend());
 
-    // 4. ȡѹݲԤָ
-    std::ifstream temp_in(temp_file, std::ios::binary);
-    std::string decompressed_content;
-    decompressed_content.assign(std::istreambuf_iterator<char>(temp_in), std::istreambuf_iterator<char>());
-    temp_in.close();
-    std::remove(temp_file.c_str());
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
 
-    if (header.hasPreprocessing()) {
-        decompressed_content = preprocessor.restore(decompressed_content);
+    std::cout << "Decompression complete!\n";
+    std::cout << "I/O: " << fileBackendName(src_file.backend()) << " read, "
+        << fileBackendName(dst_file.backend()) << " write\n";
+    std::cout << "Output size: " << output_size << " bytes\n";
+    std::cout << "Expected size: " << expected_size << " bytes";
+    if (header.sizeUnknown()) {
+        std::cout << " (from trailer, CRC-32 " << std::hex << trailer.crc32 << std::dec << " verified)";
     }
+    std::cout << "\n";
+    std::cout << "Time taken: " << duration.count() << " ms\n";
+    if (pipelined) {
+        std::cout << "Pipeline: reader, decoder and writer threads\n";
+    }
+    if (header.isBlocked()) {
+        std::cout << "Blocks: " << header.block_count << " x " << header.block_size
+            << " bytes on " << threads << " thread(s)\n";
+    }
+    else if (header.isColumnar()) {
+        std::cout << "Columnar: columns decoded on " << threads << " thread(s)\n";
+    }
+    else {
+        std::cout << "Dictionary entries: " << decompressor.getDictSize() << "\n";
+        std::cout << "Codes read: " << decompressor.getCodesRead() << "\n";
+    }
+
+    return output_size == expected_size;
+}
 
-    // 5. дս
-    std::ofstream dst_file(dst_path, std::ios::binary | std::ios::trunc);
-    if (!dst_file) {
+// ȡ
+bool extractFile(const std::string& src_path, const std::string& dst_path, const DecompressSettings& settings) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    BufferedFileWriter dst_file;
+    if (!dst_file.open(dst_path, BufferedFileWriter::DEFAULT_BUFFER_SIZE, settings.io)) {
         std::cerr << "Error: cannot open destination file for writing\n";
         return false;
     }
 
-    dst_file << decompressed_content;
-    dst_file.close();
+    bool ok = extractRange(src_path, settings.offset, settings.length, dst_file, settings.io);
+    uint64_t output_size = ok ? dst_file.position() : 0;
+    ok = dst_file.close() && ok;
+
+    if (!ok) {
+        std::cerr << "Error: range extraction failed\n";
+        removeOutput(dst_path);
+        return false;
+    }
 
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
 
-    std::cout << "Decompression complete!\n";
-    std::cout << "Output size: " << decompressed_content.length() << " bytes\n";
-    std::cout << "Expected size: " << header.original_size << " bytes\n";
+    std::cout << "Extraction complete!\n";
+    std::cout << "Offset: " << settings.offset << "\n";
+    std::cout << "Output size: " << output_size << " bytes\n";
     std::cout << "Time taken: " << duration.count() << " ms\n";
-    std::cout << "Dictionary entries: " << decompressor.getDictSize() << "\n";
-    std::cout << "Codes read: " << decompressor.getCodesRead() << "\n";
+    return true;
+}
+
+// Աȡֻȡļ鵵ͷĿ¼óԱ
+bool extractMemberFile(const std::string& src_path, const std::string& dst_path, const DecompressSettings& settings) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    BufferedFileReader src_file;
+    if (!src_file.open(src_path, BufferedFileReader::DEFAULT_BUFFER_SIZE, settings.io)) {
+        std::cerr << "Error: cannot open compressed file for reading\n";
+        return false;
+    }
+    ArchiveLayout layout;
+    if (!readArchiveLayout(src_file, layout)) {
+        return false;
+    }
+    if (!layout.header.isMulti()) {
+        std::cerr << "Error: --member needs a multi-file archive\n";
+        return false;
+    }
+
+    const MemberEntry* member = nullptr;
+    for (const auto& m : layout.members) {
+        if (m.name == settings.member) {
+            member = &m;
+            break;
+        }
+    }
+    if (!member) {
+        std::cerr << "Error: archive has no member '" << settings.member << "'\n";
+        return false;
+    }
+
+    BufferedFileWriter dst_file;
+    if (!dst_file.open(dst_path, BufferedFileWriter::DEFAULT_BUFFER_SIZE, settings.io)) {
+        std::cerr << "Error: cannot open destination file for writing\n";
+        return false;
+    }
+    dst_file.preallocate(member->original_size);
 
-    return decompressed_content.length() == header.original_size;
+    bool ok = extractMember(src_file, layout.header, *member, dst_file);
+    ok = dst_file.close() && ok;
+    if (!ok) {
+        std::cerr << "Error: member extraction failed\n";
+        removeOutput(dst_path);
+        return false;
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    std::cout << "Extraction complete!\n";
+    std::cout << "Member: " << member->name << "\n";
+    std::cout << "Output size: " << member->original_size << " bytes\n";
+    std::cout << "Time taken: " << duration.count() << " ms\n";
+    return true;
 }
 
 int main(int argc, char* argv[]) {
+    ParsedArgs args;
+    bool parsed = parseArgs(argc, argv, args);
+
+    // JSON ģʽ stdout ֻͳƽд stdout ʱ stdout ֻݣĵ stderr
+    bool data_on_stdout = isStandardStream(args.dst);
+    std::streambuf* stdout_buf = std::cout.rdbuf();
+    if (args.stats_json || data_on_stdout) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
     std::cout << "LZW File Compressor v1.0\n";
     std::cout << "Author: @logarithm1110\n\n";
-
-    ParsedArgs args;
-    if (!parseArgs(argc, argv, args)) {
+    if (!parsed) {
         return -1;
     }
 
+    if (!args.trace_path.empty()) {
+        traceEnable();
+        traceThreadName("main");
+    }
+
+    RunInfo run;
+    run.src = args.src;
+    run.dst = args.dst;
+    uint64_t start = statsNow();
+
     bool success = false;
     if (args.mode == "zip") {
-        success = compressFile(args.src, args.dst);
+        run.mode = "zip";
+        success = isDirectory(args.src)
+            ? compressDirectory(args.src, args.dst, args.zip, run)
+            : compressFile(args.src, args.dst, args.zip, run);
+    }
+    else if (!args.unzip.member.empty()) {
+        run.mode = "extract";
+        success = extractMemberFile(args.src, args.dst, args.unzip);
     }
     else {
-        success = decompressFile(args.src, args.dst);
+        run.mode = args.unzip.has_range ? "extract" : "unzip";
+        success = args.unzip.has_range
+            ? extractFile(args.src, args.dst, args.unzip)
+            : decompressFile(args.src, args.dst, args.unzip, run);
+    }
+
+    if (!args.trace_path.empty() && !writeTrace(args.trace_path)) {
+        std::cerr << "Error: cannot write trace file '" << args.trace_path << "'\n";
+    }
+
+    if (args.stats_json) {
+        run.elapsed_nanoseconds = statsNow() - start;
+        run.success = success;
+        std::cout.flush();
+        if (!data_on_stdout) {
+            std::cout.rdbuf(stdout_buf);
+        }
+        writeStatsJson(std::cout, run);
     }
 
     return success ? 0 : -1;
@@ -0,0 +1,326 @@
+#include "multi_archive.h"
+#include "block_archive.h"
+#include "bitio.h"
+#include "lzw_decompress.h"
+#include "trace.h"
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+#include <set>
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <cerrno>
+#endif
+
+// ƴĿ¼ / ָ·Windows Ҳ /
+static std::string joinPath(const std::string& root, const std::string& name) {
+    if (root.empty()) return name;
+    char last = root[root.size() - 1];
+    return last == '/' || last == '\\' ? root + name : root + "/" + name;
+}
+
+#if defined(_WIN32)
+
+bool isDirectory(const std::string& path) {
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+static bool makeDirectory(const std::string& path) {
+    return _mkdir(path.c_str()) == 0 || isDirectory(path);
+}
+
+// ݹг root/prefix µͨļĿ¼ؽ㣨ӡӣѭ
+static bool listFiles(const std::string& root, const std::string& prefix, std::vector<MemberEntry>& members) {
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((joinPath(root, prefix) + "*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error: cannot list directory '" << joinPath(root, prefix) << "'\n";
+        return false;
+    }
+    bool ok = true;
+    do {
+        std::string name = data.cFileName;
+        if (name == "." || name == "..") continue;
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (!(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+                ok = listFiles(root, prefix + name + "/", members);
+            }
+        }
+        else {
+            MemberEntry m = { prefix + name, (uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow, 0, 0 };
+            members.push_back(m);
+        }
+    } while (ok && FindNextFileA(find, &data));
+    FindClose(find);
+    return ok;
+}
+
+#else
+
+bool isDirectory(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static bool makeDirectory(const std::string& path) {
+    return ::mkdir(path.c_str(), 0777) == 0 || (errno == EEXIST && isDirectory(path));
+}
+
+// ݹг root/prefix µͨļָļķӰĿ¼ָĿ¼Ĳ룬ѭ
+static bool listFiles(const std::string& root, const std::string& prefix, std::vector<MemberEntry>& members) {
+    std::string dir_path = joinPath(root, prefix);
+    DIR* dir = ::opendir(dir_path.c_str());
+    if (!dir) {
+        std::cerr << "Error: cannot list directory '" << dir_path << "'\n";
+        return false;
+    }
+    bool ok = true;
+    while (ok) {
+        struct dirent* entry = ::readdir(dir);
+        if (!entry) break;
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        std::string path = joinPath(dir_path, name);
+        struct stat st;
+        if (::lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            ok = listFiles(root, prefix + name + "/", members);
+        }
+        else if (::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            MemberEntry m = { prefix + name, static_cast<uint64_t>(st.st_size), 0, 0 };
+            members.push_back(m);
+        }
+    }
+    ::closedir(dir);
+    return ok;
+}
+
+#endif
+
+// Ա· / ͷǿҲ .  .. \  :Windows ķ̷ָ
+static bool memberNameValid(const std::string& name) {
+    if (name.empty() || name.size() > MemberEntry::MAX_NAME) return false;
+    size_t start = 0;
+    for (;;) {
+        size_t end = name.find('/', start);
+        std::string part = name.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (part.empty() || part == "." || part == "..") return false;
+        if (part.find_first_of(std::string("\\:\0", 3)) != std::string::npos) return false;
+        if (end == std::string::npos) return true;
+        start = end + 1;
+    }
+}
+
+// Ϊ name ĸĿ¼ root ´Ŀ¼
+static bool makeParentDirectories(const std::string& root, const std::string& name) {
+    for (size_t slash = name.find('/'); slash != std::string::npos; slash = name.find('/', slash + 1)) {
+        if (!makeDirectory(joinPath(root, name.substr(0, slash)))) return false;
+    }
+    return true;
+}
+
+// ԱĴ˳ԭʼСӴС
+static std::vector<size_t> largestFirst(const std::vector<MemberEntry>& members) {
+    std::vector<size_t> order(members.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return members[a].original_size > members[b].original_size;
+    });
+    return order;
+}
+
+//  threads ߳϶ order еÿһ taskĳʧ̲ܺ߳ȡµ
+template <typename Task>
+static bool runMemberTasks(const std::vector<size_t>& order, int threads, const Task& task) {
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    auto worker = [&]() {
+        traceThreadName("member worker");
+        for (;;) {
+            size_t k = next.fetch_add(1);
+            if (k >= order.size() || failed) return;
+            if (!task(order[k])) failed = true;
+        }
+    };
+
+    size_t pool_size = std::min<size_t>(std::max(1, threads), order.size());
+    if (pool_size <= 1) {
+        worker();
+        return !failed;
+    }
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < pool_size; ++i) {
+        pool.emplace_back(worker);
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    return !failed;
+}
+
+bool listMembers(const std::string& root, std::vector<MemberEntry>& members) {
+    members.clear();
+    if (!listFiles(root, "", members)) return false;
+    std::sort(members.begin(), members.end(), [](const MemberEntry& a, const MemberEntry& b) {
+        return a.name < b.name;
+    });
+    for (const auto& m : members) {
+        if (!memberNameValid(m.name)) {
+            std::cerr << "Error: cannot store file name '" << m.name << "'\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool memberDirectoryValid(const ArchiveHeader& header, const std::vector<MemberEntry>& members,
+    uint64_t data_offset, uint64_t archive_size) {
+    if (members.size() != header.block_count) return false;
+    uint64_t total = 0;
+    // ĳԱڲнѹʱдͬһļ
+    std::set<std::string> names;
+    for (const auto& m : members) {
+        if (!memberNameValid(m.name) || !names.insert(m.name).second) return false;
+        if (m.offset < data_offset || m.offset > archive_size || m.compressed_size > archive_size - m.offset) return false;
+        if (m.original_size > UINT64_MAX - total) return false;
+        total += m.original_size;
+    }
+    return total == header.original_size;
+}
+
+// ѹһԱļ outԭգӳʱѹ˳ȡ
+static bool compressMemberFile(const std::string& path, const MemberEntry& member,
+    const MultiCompressOptions& options, std::vector<uint8_t>& out) {
+    BufferedFileReader file;
+    if (!file.open(path, BufferedFileReader::DEFAULT_BUFFER_SIZE, options.io)) {
+        std::cerr << "Error: cannot open '" << path << "' for reading\n";
+        return false;
+    }
+    if (file.fileSize() != member.original_size) {
+        std::cerr << "Error: '" << path << "' changed size while archiving\n";
+        return false;
+    }
+
+    if (file.mappedData()) {
+        return compressOneBlock(file.mappedData(), static_cast<size_t>(member.original_size), options.lzw, out);
+    }
+
+    out.clear();
+    MemoryByteSink sink(out);
+    BitWriter writer(sink);
+    LZWCompressor compressor(options.lzw);
+    if (!compressor.compressStream(file, writer) || !writer.flush()) return false;
+    if (file.failed()) {
+        std::cerr << "Error: failed to read '" << path << "'\n";
+        return false;
+    }
+    if (compressor.getInputSize() != member.original_size) {
+        std::cerr << "Error: '" << path << "' changed size while archiving\n";
+        return false;
+    }
+    return true;
+}
+
+bool compressMembers(const std::string& root, std::vector<MemberEntry>& members,
+    const MultiCompressOptions& options, BufferedFileWriter& out) {
+    std::mutex mutex;
+    bool write_failed = false;
+
+    bool ok = runMemberTasks(largestFirst(members), options.threads, [&](size_t i) {
+        MemberEntry& member = members[i];
+        TraceScope trace("compressMember", "task");
+        trace.setBytes(member.original_size);
+
+        std::vector<uint8_t> buffer;
+        if (!compressMemberFile(joinPath(root, member.name), member, options, buffer)) return false;
+
+        // Ⱥ׷ӣƫƼĿ¼
+        std::lock_guard<std::mutex> lock(mutex);
+        member.offset = out.position();
+        member.compressed_size = buffer.size();
+        if (!out.write(buffer.data(), buffer.size())) {
+            write_failed = true;
+            return false;
+        }
+        return true;
+    });
+
+    if (write_failed) {
+        std::cerr << "Error: failed to write compressed data\n";
+    }
+    return ok;
+}
+
+bool extractMember(BufferedFileReader& in, const ArchiveHeader& header, const MemberEntry& member, ByteSink& out) {
+    TraceScope trace("extractMember", "task");
+    trace.setBytes(member.original_size);
+
+    // ӳĹ鵵ֱӴӳ룬λóԱ
+    std::vector<uint8_t> compressed;
+    const uint8_t* data = in.mappedData() ? in.mappedData() + member.offset : nullptr;
+    size_t size = static_cast<size_t>(member.compressed_size);
+    if (!data) {
+        compressed.resize(size);
+        if (!in.readAt(member.offset, compressed.data(), size)) {
+            std::cerr << "Error: member '" << member.name << "' is truncated\n";
+            return false;
+        }
+        data = compressed.data();
+    }
+
+    MemoryByteSource source(data, size);
+    BitReader reader(source);
+    LZWDecompressor decompressor(LZWDecompressOptions(ArchiveHeader::MIN_CODE_WIDTH, header.max_code_width));
+    if (!decompressor.decompressStream(reader, out)) {
+        std::cerr << "Error: member '" << member.name << "' failed to decode\n";
+        return false;
+    }
+    if (decompressor.getOutputSize() != member.original_size) {
+        std::cerr << "Error: member '" << member.name << "' size mismatch\n";
+        return false;
+    }
+    return true;
+}
+
+bool decompressMembers(BufferedFileReader& in, const ArchiveHeader& header, const std::vector<MemberEntry>& members,
+    const std::string& root, int threads, FileBackend io) {
+    // Ŀ¼߳ϰ˳򴴽ֻ߳дļ
+    if (!makeDirectory(root)) {
+        std::cerr << "Error: cannot create directory '" << root << "'\n";
+        return false;
+    }
+    for (const auto& m : members) {
+        if (!makeParentDirectories(root, m.name)) {
+            std::cerr << "Error: cannot create the directory for '" << m.name << "'\n";
+            return false;
+        }
+    }
+
+    return runMemberTasks(largestFirst(members), threads, [&](size_t i) {
+        const MemberEntry& member = members[i];
+        std::string path = joinPath(root, member.name);
+        BufferedFileWriter file;
+        if (!file.open(path, BufferedFileWriter::DEFAULT_BUFFER_SIZE, io)) {
+            std::cerr << "Error: cannot open '" << path << "' for writing\n";
+            return false;
+        }
+        file.preallocate(member.original_size);
+        bool ok = extractMember(in, header, member, file);
+        ok = file.close() && ok;
+        if (!ok) {
+            std::remove(path.c_str());
+        }
+        return ok;
+    });
+}
@@ -0,0 +1,47 @@
+#ifndef MULTI_ARCHIVE_H
+#define MULTI_ARCHIVE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "format.h"
+#include "fileio.h"
+#include "lzw_compress.h"
+
+// ļ鵵version 4һĿ¼µͨļѹɶ LZW 
+// header ֮ĳԱĿ¼¼ÿԱ·ԭʼСƫ볤ȣʽ format.h
+// Ա֮以ѹѹԱ䵽̳߳ϣȡԱֻȡԼ
+
+// ļѹ
+struct MultiCompressOptions {
+    LZWCompressOptions lzw;
+    int threads = 1;                         // ͬʱѹĳԱ
+    FileBackend io = FileBackend::Auto;      // ȡԱļĺ
+};
+
+// path ǷΪĿ¼
+bool isDirectory(const std::string& path);
+
+// ݹг root µͨļname Ϊ / ָ·
+// ֻд name  original_size
+bool listMembers(const std::string& root, std::vector<MemberEntry>& members);
+
+// ԱĿ¼·Ҳ .. ȷظλ [data_offset, archive_size) ڣ
+// ԭʼС֮͵ header е original_size
+bool memberDirectoryValid(const ArchiveHeader& header, const std::vector<MemberEntry>& members,
+    uint64_t data_offset, uint64_t archive_size);
+
+// ̳߳ѹ root µĸԱȺ׷ӵ outǰλüһ㣩
+// д members е offset  compressed_sizeԱȡʹ̵߳ĸӽ
+// ÿ߳ͬʱֻһԱѹ
+bool compressMembers(const std::string& root, std::vector<MemberEntry>& members,
+    const MultiCompressOptions& options, BufferedFileWriter& out);
+
+// һԱѹ outֽĿ¼еԭʼСһ
+bool extractMember(BufferedFileReader& in, const ArchiveHeader& header, const MemberEntry& member, ByteSink& out);
+
+//  threads ߳ϰȫԱѹĿ¼ root £ҪʱĿ¼
+bool decompressMembers(BufferedFileReader& in, const ArchiveHeader& header, const std::vector<MemberEntry>& members,
+    const std::string& root, int threads, FileBackend io = FileBackend::Auto);
+
+#endif
@@ -0,0 +1,168 @@
+#include "pipeline.h"
+#include "stats.h"
+#include "trace.h"
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+ChunkRing::ChunkRing(std::size_t slots, std::size_t chunk_size)
+    : slots_(std::max<std::size_t>(slots, 2)), sizes_(slots_.size(), 0), chunk_size_(chunk_size) {
+    for (auto& slot : slots_) {
+        slot.resize(chunk_size_);
+    }
+}
+
+uint8_t* ChunkRing::acquire() {
+    StageScope stage(Stage::Wait);
+    TraceScope trace("ChunkRing::acquire", "wait");
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [&] { return aborted_ || tail_ - head_ < slots_.size(); });
+    if (aborted_) return nullptr;
+    return slots_[tail_ % slots_.size()].data();
+}
+
+void ChunkRing::commit(std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sizes_[tail_ % slots_.size()] = size;
+    tail_++;
+    not_empty_.notify_one();
+}
+
+void ChunkRing::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+}
+
+bool ChunkRing::next(const uint8_t*& data, std::size_t& size) {
+    StageScope stage(Stage::Wait);
+    TraceScope trace("ChunkRing::next", "wait");
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&] { return aborted_ || closed_ || head_ < tail_; });
+    if (aborted_ || head_ == tail_) return false;
+    data = slots_[head_ % slots_.size()].data();
+    size = sizes_[head_ % slots_.size()];
+    return true;
+}
+
+void ChunkRing::release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    head_++;
+    not_full_.notify_one();
+}
+
+void ChunkRing::abort() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aborted_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+}
+
+bool RingByteSink::write(const uint8_t* data, std::size_t size) {
+    while (size > 0) {
+        if (!chunk_) {
+            chunk_ = ring_.acquire();
+            if (!chunk_) return false;
+            used_ = 0;
+        }
+        std::size_t n = std::min(size, ring_.chunkSize() - used_);
+        std::memcpy(chunk_ + used_, data, n);
+        used_ += n;
+        data += n;
+        size -= n;
+        if (used_ == ring_.chunkSize()) {
+            ring_.commit(used_);
+            chunk_ = nullptr;
+        }
+    }
+    return true;
+}
+
+bool RingByteSink::flush() {
+    if (chunk_ && used_ > 0) {
+        ring_.commit(used_);
+        chunk_ = nullptr;
+    }
+    return true;
+}
+
+std::size_t RingByteSource::read(uint8_t* buf, std::size_t size) {
+    while (pos_ == size_) {
+        if (held_) {
+            ring_.release();
+            held_ = false;
+        }
+        if (!ring_.next(chunk_, size_)) return 0;
+        held_ = true;
+        pos_ = 0;
+    }
+    std::size_t n = std::min(size, size_ - pos_);
+    std::memcpy(buf, chunk_ + pos_, n);
+    pos_ += n;
+    return n;
+}
+
+bool runPipeline(BufferedFileReader& in, BufferedFileWriter& out, const PipelineOptions& options,
+    const std::function<bool(ByteSource&, ByteSink&)>& coder) {
+    ChunkRing input(options.slots, options.chunk_size);
+    ChunkRing output(options.slots, options.chunk_size);
+    std::atomic<bool> read_failed(false);
+    std::atomic<bool> write_failed(false);
+
+    // 读线程：逐块读满后提交，读到末尾时关闭输入队列；读取出错时中止，不能当作输入结束
+    std::thread reader([&]() {
+        traceThreadName("pipeline reader");
+        for (;;) {
+            uint8_t* chunk = input.acquire();
+            if (!chunk) return;
+            std::size_t got = 0;
+            while (got < input.chunkSize()) {
+                std::size_t n = in.read(chunk + got, input.chunkSize() - got);
+                if (n == 0) break;
+                got += n;
+            }
+            if (in.failed()) {
+                read_failed = true;
+                input.abort();
+                return;
+            }
+            if (got > 0) input.commit(got);
+            if (got < input.chunkSize()) {
+                input.close();
+                return;
+            }
+        }
+    });
+
+    // 写线程：按提交顺序写出，写入失败时中止输出队列让编解码停下
+    std::thread writer([&]() {
+        traceThreadName("pipeline writer");
+        const uint8_t* data;
+        std::size_t size;
+        while (output.next(data, size)) {
+            if (!out.write(data, size)) {
+                write_failed = true;
+                output.abort();
+                return;
+            }
+            output.release();
+        }
+    });
+
+    RingByteSource source(input);
+    RingByteSink sink(output);
+    bool ok = coder(source, sink) && sink.flush();
+    if (ok) {
+        output.close();
+    }
+    else {
+        output.abort();
+    }
+    // 编解码可能在读完输入之前结束（如码流后的多余字节），中止读线程
+    input.abort();
+
+    writer.join();
+    reader.join();
+    return ok && !read_failed && !write_failed && out.flush();
+}
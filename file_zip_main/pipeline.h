@@ -0,0 +1,95 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "fileio.h"
+
+// 流水线参数
+struct PipelineOptions {
+    std::size_t chunk_size = 1024 * 1024;  // 每块字节数
+    std::size_t slots = 4;                 // 每个环形队列的块数（读、写各一个）
+};
+
+// 在两个线程之间传递大块数据的有界环形队列（单生产者单消费者）
+// 块的内存在构造时一次分配并循环使用；每块只在交接时加锁一次，块足够大时锁的开销可以忽略
+class ChunkRing {
+public:
+    ChunkRing(std::size_t slots, std::size_t chunk_size);
+
+    ChunkRing(const ChunkRing&) = delete;
+    ChunkRing& operator=(const ChunkRing&) = delete;
+
+    // 生产者：等待一个空块并返回其内存（chunkSize() 字节），队列已中止时返回 nullptr
+    uint8_t* acquire();
+
+    // 生产者：提交 acquire 得到的块，其中有效数据 size 字节
+    void commit(std::size_t size);
+
+    // 生产者：数据已全部提交
+    void close();
+
+    // 消费者：等待下一个已提交的块，队列关闭且取空或已中止时返回 false
+    bool next(const uint8_t*& data, std::size_t& size);
+
+    // 消费者：归还 next 得到的块
+    void release();
+
+    // 任一方出错时中止，唤醒所有等待的线程
+    void abort();
+
+    std::size_t chunkSize() const { return chunk_size_; }
+
+private:
+    std::vector<std::vector<uint8_t>> slots_;
+    std::vector<std::size_t> sizes_;
+    std::size_t chunk_size_;
+    uint64_t head_ = 0;   // 已归还的块数
+    uint64_t tail_ = 0;   // 已提交的块数
+    bool closed_ = false;
+    bool aborted_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+// 把写入的数据攒成整块提交到环形队列的输出端
+class RingByteSink : public ByteSink {
+public:
+    explicit RingByteSink(ChunkRing& ring) : ring_(ring) {}
+
+    bool write(const uint8_t* data, std::size_t size) override;
+
+    // 提交未满的当前块
+    bool flush() override;
+
+private:
+    ChunkRing& ring_;
+    uint8_t* chunk_ = nullptr;
+    std::size_t used_ = 0;
+};
+
+// 从环形队列逐块读取的输入端
+class RingByteSource : public ByteSource {
+public:
+    explicit RingByteSource(ChunkRing& ring) : ring_(ring) {}
+
+    std::size_t read(uint8_t* buf, std::size_t size) override;
+
+private:
+    ChunkRing& ring_;
+    const uint8_t* chunk_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t pos_ = 0;
+    bool held_ = false;
+};
+
+// 三级流水线：读线程从 in 的当前位置读到文件末尾，写线程把结果写入 out，
+// 调用线程在两者之间运行 coder(source, sink)；磁盘读写的等待与编解码重叠进行
+bool runPipeline(BufferedFileReader& in, BufferedFileWriter& out, const PipelineOptions& options,
+    const std::function<bool(ByteSource&, ByteSink&)>& coder);
+
+#endif
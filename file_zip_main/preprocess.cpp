@@ -2,6 +2,11 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <queue>
+#include "suffix_array.h"
+#include "stats.h"
+#include "trace.h"
 using namespace std;
 
 preprocessor::preprocessor() {
@@ -10,44 +15,44 @@ preprocessor::preprocessor() {
 
 void preprocessor::initialize_replacements(){
 	vector<pair<string, string>>patterns = {
-		//־ͷϢ
-        {"#Software: Hllpoj Server 1.0.1 / Logger 1.0.0 built 0001","SW"},
-		{"#Version: 1.0","V1"},
-        {"#Fields: date time s-ip cs-method cs-uri-stem cs-uri-query s-port cs-username c-ip cs(User-Agent) cs(Referer) sc-status sc-substatus sc-win32-status time-taken", "F1"},
-
-        //User-Agent
-        {"Mozilla/5.0+(Linux;+U;+Android+8.0.0;+en-us;+MIX+2+Build/OPR1.170623.027)+AppleWebKit/537.36+(KHTML,+like+Gecko)+Version/4.0+Chrome/61.0.3163.128+Mobile+Safari/537.36+XiaoMi/MiuiBrowser/10.5.2", "UA1"},
-        {"Mozilla/5.0+(Windows+NT+6.3;+Win64;+x64)+AppleWebKit/537.36+(KHTML,+like+Gecko)+Chrome/72.0.3626.121+Safari/537.36", "UA2"},
-        {"Mozilla/5.0+(Macintosh;+Intel+Mac+OS+X+10_13_6)+AppleWebKit/605.1.15+(KHTML,+like+Gecko)+Version/12.0.3+Safari/605.1.15", "UA3"},
-
-        //ڡ
-        {"2019-03-13 ", "DATE"},
-
-        //IP
-        {"***.***.***.***", "IP"},  
-
-        //URL
-        {"/login.php", "LOGIN"},
-        {"/default/******.php", "DEFPHP"},
-        {"/default/******.htm", "DEFHTM"},
-        {"/files/assets/", "ASSETS"},
-        {"/files/bower_components/", "BOWER"},
-
-        //HTTP
-        {" POST ", "POST"},
-        {" GET ", "GET"},
-        {" 200 ", "200"}, 
-        {" 304 ", "304"}, 
-        {" 404 ", "404"},
-
-        //ѯ
-        {"problemid=7_1", "PID71"},
-        {"problemid=7_2", "PID72"},
-        {"problemid=7_3", "PID73"},
-        {"problemid=7_2_f", "PID72F"},
-
-        //Ӧʱ
-        {" time-taken", "TIME"},
+		//日志头部信息√
+        {"#Software: Hllpoj Server 1.0.1 / Logger 1.0.0 built 0001","§SW§"},
+		{"#Version: 1.0","§V1§"},
+        {"#Fields: date time s-ip cs-method cs-uri-stem cs-uri-query s-port cs-username c-ip cs(User-Agent) cs(Referer) sc-status sc-substatus sc-win32-status time-taken", "§F1§"},
+
+        //User-Agent√
+        {"Mozilla/5.0+(Linux;+U;+Android+8.0.0;+en-us;+MIX+2+Build/OPR1.170623.027)+AppleWebKit/537.36+(KHTML,+like+Gecko)+Version/4.0+Chrome/61.0.3163.128+Mobile+Safari/537.36+XiaoMi/MiuiBrowser/10.5.2", "§UA1§"},
+        {"Mozilla/5.0+(Windows+NT+6.3;+Win64;+x64)+AppleWebKit/537.36+(KHTML,+like+Gecko)+Chrome/72.0.3626.121+Safari/537.36", "§UA2§"},
+        {"Mozilla/5.0+(Macintosh;+Intel+Mac+OS+X+10_13_6)+AppleWebKit/605.1.15+(KHTML,+like+Gecko)+Version/12.0.3+Safari/605.1.15", "§UA3§"},
+
+        //日期√
+        {"2019-03-13 ", "§DATE§"},
+
+        //IP√
+        {"***.***.***.***", "§IP§"},  
+
+        //URL√
+        {"/login.php", "§LOGIN§"},
+        {"/default/******.php", "§DEFPHP§"},
+        {"/default/******.htm", "§DEFHTM§"},
+        {"/files/assets/", "§ASSETS§"},
+        {"/files/bower_components/", "§BOWER§"},
+
+        //HTTP√
+        {" POST ", "§POST§"},
+        {" GET ", "§GET§"},
+        {" 200 ", "§200§"}, 
+        {" 304 ", "§304§"}, 
+        {" 404 ", "§404§"},
+
+        //查询参数√
+        {"problemid=7_1", "§PID71§"},
+        {"problemid=7_2", "§PID72§"},
+        {"problemid=7_3", "§PID73§"},
+        {"problemid=7_2_f", "§PID72F§"},
+
+        //响应时间√
+        {" time-taken", "§TIME§"},
     };
 
     for (size_t i = 0; i < patterns.size(); ++i) {
@@ -57,101 +62,241 @@ void preprocessor::initialize_replacements(){
 		pattern_to_token[p.first] = p.second;
 		token_to_pattern[p.second] = p.first;
     }
+    add_escape_entry();
+    build_automata();
 }
 
 string preprocessor::generate_token(int index) {
-    return "T" + to_string(index) + "";
+    return "§T" + to_string(index) + "§";
 }
 
-void  preprocessor::replace_all(string& text, const string& from, const string& to) {
-    if (from.empty())return;
-
-    size_t pos = 0;
-    while ((pos = text.find(from, pos)) != string::npos) {
-        text.replace(pos, from.length(), to);
-        pos += to.length();
-    }
+// 标记都以 § 开头和结尾、中间不含 §：原文中的 § 写成 §§，恢复时再换回，
+// 这样原文里与标记相同的文字不会被误恢复。旧归档的表中没有这一条，按原来的方式恢复
+void preprocessor::add_escape_entry() {
+    const string mark = "§";
+    const string escaped = mark + mark;
+    replacements_list.emplace_back(mark, escaped);
+    pattern_to_token[mark] = escaped;
+    token_to_pattern[escaped] = mark;
 }
 
-string preprocessor::preprocess(const string& input) {
-    string result = input;
-
+void preprocessor::build_automata() {
+    vector<pair<string, string>> forward;
+    vector<pair<string, string>> backward;
     for (const auto& entry : replacements_list) {
-        replace_all(result, entry.pattern, entry.token);
+        forward.emplace_back(entry.pattern, entry.token);
+        backward.emplace_back(entry.token, entry.pattern);
     }
+    replacer.build(forward);
+    restorer.build(backward);
+}
 
+// 一遍扫描完成全部替换：多个模式在同一位置匹配时取最长的，匹配互不重叠
+string preprocessor::preprocess(const string& input) {
+    string result;
+    result.reserve(input.size());
+    replacer.replace_all(reinterpret_cast<const uint8_t*>(input.data()), input.size(), result);
     return result;
 }
 
 string preprocessor::restore(const string& processed) {
-    string result = processed;
+    string result;
+    result.reserve(processed.size() * 2);
+    restorer.replace_all(reinterpret_cast<const uint8_t*>(processed.data()), processed.size(), result);
+    return result;
+}
+
+namespace {
+
+// 训练参数：短于 MIN_LEN 的子串换成标记后省不了几个字节
+const size_t TRAIN_MIN_LEN = 12;
+const size_t TRAIN_MAX_LEN = 255;
+const uint32_t TRAIN_MIN_COUNT = 4;
+const size_t TRAIN_MAX_CANDIDATES = 4096;
+
+struct train_candidate {
+    std::string text;
+    uint32_t count;   // 在样本中出现的次数（后缀数组区间的大小）
+    double score;     // 预计节省的字节数
+
+    bool operator<(const train_candidate& other) const { return score < other.score; }
+    bool operator>(const train_candidate& other) const { return score > other.score; }
+};
 
-    for (auto it = replacements_list.rbegin(); it != replacements_list.rend(); ++it) {
-        replace_all(result, it->token, it->pattern);
+size_t count_occurrences(const std::string& haystack, const std::string& needle) {
+    size_t n = 0;
+    for (size_t pos = haystack.find(needle); pos != string::npos; pos = haystack.find(needle, pos + 1)) ++n;
+    return n;
+}
+
+} // namespace
+
+size_t preprocessor::train(const vector<string>& samples, size_t max_entries) {
+    // 1. 拼接样本，片段之间放互不相同的分隔符（取值 >= 256），公共前缀不会跨越片段
+    vector<int32_t> text;
+    int32_t separator = 256;
+    for (const auto& sample : samples) {
+        for (unsigned char c : sample) text.push_back(c);
+        text.push_back(separator++);
     }
 
-    return result;
+    vector<int32_t> sa = build_suffix_array(text, separator);
+    vector<int32_t> lcp = build_lcp_array(text, sa);
+
+    // 2. 自底向上遍历 LCP 区间：区间 [lb, rb] 内的后缀共有长为 lcp 的前缀，出现 rb - lb + 1 次
+    //    只保留预计收益最高的一批候选
+    const string token_mark = generate_token(0).substr(0, 2);
+    priority_queue<train_candidate, vector<train_candidate>, greater<train_candidate>> best;  // 最小堆
+    auto report = [&](int32_t length, int32_t lb, int32_t rb) {
+        size_t len = min(static_cast<size_t>(length), TRAIN_MAX_LEN);
+        uint32_t count = static_cast<uint32_t>(rb - lb + 1);
+        if (len < TRAIN_MIN_LEN || count < TRAIN_MIN_COUNT) return;
+
+        double score = static_cast<double>(count) * static_cast<double>(len);
+        if (best.size() == TRAIN_MAX_CANDIDATES && score <= best.top().score) return;
+
+        train_candidate candidate;
+        candidate.text.reserve(len);
+        for (size_t i = 0; i < len; ++i) candidate.text.push_back(static_cast<char>(text[sa[lb] + i]));
+        if (candidate.text.find(token_mark) != string::npos) return;  // 不能含有标记的前缀
+        candidate.count = count;
+        candidate.score = score;
+        best.push(candidate);
+        if (best.size() > TRAIN_MAX_CANDIDATES) best.pop();
+    };
+
+    vector<pair<int32_t, int32_t>> stack = { {0, 0} };  // (lcp, lb)
+    const int32_t n = static_cast<int32_t>(text.size());
+    for (int32_t i = 1; i <= n; ++i) {
+        int32_t h = i < n ? lcp[i] : 0;
+        int32_t lb = i - 1;
+        while (stack.back().first > h) {
+            auto top = stack.back();
+            stack.pop_back();
+            report(top.first, top.second, i - 1);
+            lb = top.second;
+        }
+        if (stack.back().first < h) stack.emplace_back(h, lb);
+    }
+
+    // 3. 贪心选取：已选的串会影响候选的实际收益，取出时重新估算，
+    //    仍不低于剩余候选中最高的估算值才选中
+    priority_queue<train_candidate> queue;
+    while (!best.empty()) {
+        queue.push(best.top());
+        best.pop();
+    }
+
+    vector<replacement_entry> chosen;
+    vector<uint32_t> chosen_count;
+    int token_index = 0;
+    while (chosen.size() < max_entries && !queue.empty()) {
+        train_candidate candidate = queue.top();
+        queue.pop();
+
+        // 原文中与标记相同的文字由 § 的转义保护，标记不必避开输入
+        string token = generate_token(token_index);
+
+        // 已被更长的串覆盖的出现次数不再计入；包含的较短串已经替换掉的部分不再节省
+        double count = candidate.count;
+        double saving = static_cast<double>(candidate.text.size()) - static_cast<double>(token.size());
+        bool duplicate = false;
+        for (size_t i = 0; i < chosen.size() && !duplicate; ++i) {
+            const string& other = chosen[i].pattern;
+            if (other == candidate.text) {
+                duplicate = true;
+            }
+            else if (other.size() > candidate.text.size()) {
+                count -= static_cast<double>(chosen_count[i]) * count_occurrences(other, candidate.text);
+            }
+            else {
+                saving -= static_cast<double>(count_occurrences(candidate.text, other))
+                    * static_cast<double>(other.size() - chosen[i].token.size());
+            }
+        }
+        if (duplicate || count < TRAIN_MIN_COUNT || saving <= 0) continue;
+
+        // 表本身也要占用空间
+        double score = count * saving - static_cast<double>(candidate.text.size() + token.size() + 2 * sizeof(uint32_t));
+        if (score <= 0) continue;
+        if (!queue.empty() && score < queue.top().score) {
+            candidate.score = score;
+            queue.push(candidate);
+            continue;
+        }
+
+        chosen.emplace_back(candidate.text, token);
+        chosen_count.push_back(candidate.count);
+        ++token_index;
+    }
+
+    clear();
+    for (const auto& entry : chosen) {
+        replacements_list.push_back(entry);
+        pattern_to_token[entry.pattern] = entry.token;
+        token_to_pattern[entry.token] = entry.pattern;
+    }
+    add_escape_entry();
+    build_automata();
+    return chosen.size();
 }
 
-bool preprocessor::serialize_table(ofstream& out) const {
-    if (!out.good()) return false;
+bool preprocessor::serialize_table(ByteSink& out) const {
+    // 先在内存中拼好整张表，一次写出
+    vector<uint8_t> bytes;
+    auto put = [&bytes](const void* p, size_t n) {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        bytes.insert(bytes.end(), b, b + n);
+    };
 
     uint32_t count = static_cast<uint32_t>(replacements_list.size());
-    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    put(&count, sizeof(count));
 
     for (const auto& entry : replacements_list) {
-        // д pattern Ⱥ
+        // 写入 pattern 长度和内容
         uint32_t pattern_len = static_cast<uint32_t>(entry.pattern.length());
-        out.write(reinterpret_cast<const char*>(&pattern_len), sizeof(pattern_len));
-        out.write(entry.pattern.c_str(), pattern_len);
+        put(&pattern_len, sizeof(pattern_len));
+        put(entry.pattern.data(), pattern_len);
 
-        // д token Ⱥ
+        // 写入 token 长度和内容
         uint32_t token_len = static_cast<uint32_t>(entry.token.length());
-        out.write(reinterpret_cast<const char*>(&token_len), sizeof(token_len));
-        out.write(entry.token.c_str(), token_len);
+        put(&token_len, sizeof(token_len));
+        put(entry.token.data(), token_len);
     }
 
-    return out.good();
+    return out.write(bytes.data(), bytes.size());
 }
 
-bool preprocessor::deserialize_table(ifstream& in) {
-    if (!in.good()) return false;
-
+bool preprocessor::deserialize_table(ByteSource& in) {
     clear();
 
-    // ȡ滻Ŀ
+    // 读取替换表条目数量
     uint32_t count;
-    in.read(reinterpret_cast<char*>(&count), sizeof(count));
-    if (!in.good()) return false;
-
-    replacements_list.reserve(count);
+    if (!readExact(in, &count, sizeof(count))) return false;
 
     for (uint32_t i = 0; i < count; ++i) {
-        // ȡ pattern
+        // 读取 pattern
         uint32_t pattern_len;
-        in.read(reinterpret_cast<char*>(&pattern_len), sizeof(pattern_len));
-        if (!in.good()) return false;
+        if (!readExact(in, &pattern_len, sizeof(pattern_len))) return false;
 
         string pattern(pattern_len, '\0');
-        in.read(&pattern[0], pattern_len);
-        if (!in.good()) return false;
+        if (!readExact(in, &pattern[0], pattern_len)) return false;
 
-        // ȡ token
+        // 读取 token
         uint32_t token_len;
-        in.read(reinterpret_cast<char*>(&token_len), sizeof(token_len));
-        if (!in.good()) return false;
+        if (!readExact(in, &token_len, sizeof(token_len))) return false;
 
         std::string token(token_len, '\0');
-        in.read(&token[0], token_len);
-        if (!in.good()) return false;
+        if (!readExact(in, &token[0], token_len)) return false;
 
-        // ӵ滻
+        // 添加到替换表
         replacement_entry entry(pattern, token);
         replacements_list.push_back(entry);
         pattern_to_token[pattern] = token;
         token_to_pattern[token] = pattern;
     }
 
+    build_automata();
     return true;
 }
 
@@ -168,4 +313,63 @@ void preprocessor::clear() {
     replacements_list.clear();
     pattern_to_token.clear();
     token_to_pattern.clear();
-}
\ No newline at end of file
+    build_automata();
+}
+
+preprocess_source::preprocess_source(const preprocessor& table, ByteSource& upstream, size_t chunk_size)
+    : upstream(upstream), rewriter(table.get_replacer()), chunk(chunk_size) {
+}
+
+size_t preprocess_source::read(uint8_t* buf, size_t size) {
+    StageScope stage(Stage::Preprocess);
+    TraceScope trace("preprocess", "preprocess");
+    while (output_pos == output.size()) {
+        if (finished) return 0;
+        output.clear();
+        output_pos = 0;
+
+        size_t got = upstream.read(chunk.data(), chunk.size());
+        if (got == 0) {
+            rewriter.finish(output);
+            finished = true;
+        }
+        else {
+            rewriter.feed(chunk.data(), got, output);
+            input_size += got;
+        }
+        stage.addBytes(got, output.size());
+    }
+
+    size_t n = min(size, output.size() - output_pos);
+    copy(output.data() + output_pos, output.data() + output_pos + n, buf);
+    output_pos += n;
+    return n;
+}
+
+restore_sink::restore_sink(const preprocessor& table, ByteSink& downstream)
+    : downstream(downstream), rewriter(table.get_restorer()) {
+}
+
+bool restore_sink::write(const uint8_t* data, size_t size) {
+    StageScope stage(Stage::Preprocess);
+    TraceScope trace("restore", "preprocess");
+    trace.setBytes(size);
+    rewriter.feed(data, size, output);
+    stage.addBytes(size, output.size());
+    return emit();
+}
+
+bool restore_sink::finish() {
+    StageScope stage(Stage::Preprocess);
+    TraceScope trace("restore", "preprocess");
+    rewriter.finish(output);
+    stage.addBytes(0, output.size());
+    return emit();
+}
+
+bool restore_sink::emit() {
+    if (output.empty()) return true;
+    bool ok = downstream.write(reinterpret_cast<const uint8_t*>(output.data()), output.size());
+    output.clear();
+    return ok;
+}
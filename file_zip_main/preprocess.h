@@ -5,10 +5,12 @@
 #include <vector>
 #include <unordered_map>
 #include<fstream>
+#include "fileio.h"
+#include "aho_corasick.h"
 
 struct replacement_entry {
-	std::string pattern;//ԭʼģʽ
-	std::string token;//滻
+	std::string pattern;//原始模式
+	std::string token;//替换标记
 
 	replacement_entry(const std::string& p, const std::string& t) : pattern(p), token(t) {}
 };
@@ -20,20 +22,77 @@ public:
 	std::string preprocess(const std::string& input);
 	std::string restore(const std::string& processed);
 
-	bool serialize_table(std::ofstream& out) const;
-	bool deserialize_table(std::ifstream& in);
+	// 训练：用后缀数组在样本中找出替换收益最大的重复长子串，取代内置的表
+	// samples 为输入中互不相连的若干片段，匹配不会跨越片段；返回训练出的条目数（不含 § 的转义）
+	static const size_t DEFAULT_TRAIN_ENTRIES = 64;
+	size_t train(const std::vector<std::string>& samples, size_t max_entries = DEFAULT_TRAIN_ENTRIES);
+
+	bool serialize_table(ByteSink& out) const;
+	bool deserialize_table(ByteSource& in);
 
 	size_t get_replacement_count() const;
 
+	const std::vector<replacement_entry>& get_entries() const { return replacements_list; }
+
+	// 模式 → 标记、标记 → 模式 两个方向的自动机
+	const aho_corasick& get_replacer() const { return replacer; }
+	const aho_corasick& get_restorer() const { return restorer; }
+
 	void clear();
 private:
 	std::vector<replacement_entry> replacements_list;
 	std::unordered_map<std::string, std::string> pattern_to_token;
 	std::unordered_map<std::string, std::string> token_to_pattern;
+	aho_corasick replacer;
+	aho_corasick restorer;
 	
 	void initialize_replacements();
 	std::string generate_token(int index);
-	void replace_all(std::string& text, const std::string& from, const std::string& to);
+	void add_escape_entry();
+	void build_automata();
+};
+
+// 流式预处理：从上游按块读取原始数据，替换后的数据供下游（压缩器）读取
+// 跨块的部分匹配由 stream_rewriter 保存，内存只与块大小有关
+class preprocess_source : public ByteSource {
+public:
+	static const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+	preprocess_source(const preprocessor& table, ByteSource& upstream, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+	size_t read(uint8_t* buf, size_t size) override;
+
+	// 已从上游读取的原始字节数
+	uint64_t get_input_size() const { return input_size; }
+
+private:
+	ByteSource& upstream;
+	stream_rewriter rewriter;
+	std::vector<uint8_t> chunk;
+	std::string output;
+	size_t output_pos = 0;
+	uint64_t input_size = 0;
+	bool finished = false;
+};
+
+// 流式恢复：把解码输出中的标记替换回原始模式后写入下游
+// 只保留尚未确定的尾部，内存与文件大小无关
+class restore_sink : public ByteSink {
+public:
+	restore_sink(const preprocessor& table, ByteSink& downstream);
+
+	bool write(const uint8_t* data, size_t size) override;
+	bool flush() override { return downstream.flush(); }
+
+	// 处理剩余的尾部数据，必须在最后一次 write 之后调用
+	bool finish();
+
+private:
+	ByteSink& downstream;
+	stream_rewriter rewriter;
+	std::string output;
+
+	bool emit();
 };
 
 #endif
\ No newline at end of file
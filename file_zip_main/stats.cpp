@@ -0,0 +1,270 @@
+#include "stats.h"
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+#include <iomanip>
+
+static const int STAGE_COUNT = static_cast<int>(Stage::Count);
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+    case Stage::Read: return "read";
+    case Stage::Preprocess: return "preprocess";
+    case Stage::Code: return "code";
+    case Stage::BitPack: return "bit_pack";
+    case Stage::Write: return "write";
+    case Stage::Wait: return "wait";
+    default: return "unknown";
+    }
+}
+
+uint64_t statsNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void CoderCounters::merge(const CoderCounters& other) {
+    streams += other.streams;
+    input_bytes += other.input_bytes;
+    output_bytes += other.output_bytes;
+    codes += other.codes;
+    lookups += other.lookups;
+    probes += other.probes;
+    resets += other.resets;
+    width_changes += other.width_changes;
+    dictionary_fills += other.dictionary_fills;
+    fill_nanoseconds += other.fill_nanoseconds;
+    events_dropped += other.events_dropped;
+    for (const CoderEvent& e : other.events) {
+        if (events.size() < MAX_EVENTS) {
+            events.push_back(e);
+        }
+        else {
+            ++events_dropped;
+        }
+    }
+}
+
+// ȫֻܣе̵߳Ǽ live У߳̽ʱԼļ retired
+struct StatsRegistry;
+
+struct ThreadStages {
+    static const int MAX_DEPTH = 16;
+
+    StageCounters stages[STAGE_COUNT];
+    Stage stack[MAX_DEPTH];
+    int depth = 0;
+    uint64_t mark = 0;   // һν뿪׶εʱ
+
+    ThreadStages();
+    ~ThreadStages();
+};
+
+struct StatsRegistry {
+    std::mutex mutex;
+    std::vector<ThreadStages*> live;
+    StageCounters retired[STAGE_COUNT];
+    CoderCounters encoder;
+    CoderCounters decoder;
+};
+
+static StatsRegistry& registry() {
+    // ̵߳ thread_local ھ̬֮Ž
+    static StatsRegistry* r = new StatsRegistry();
+    return *r;
+}
+
+ThreadStages::ThreadStages() {
+    StatsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.push_back(this);
+}
+
+ThreadStages::~ThreadStages() {
+    StatsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        r.retired[i].nanoseconds += stages[i].nanoseconds;
+        r.retired[i].calls += stages[i].calls;
+        r.retired[i].bytes_in += stages[i].bytes_in;
+        r.retired[i].bytes_out += stages[i].bytes_out;
+    }
+    r.live.erase(std::remove(r.live.begin(), r.live.end(), this), r.live.end());
+}
+
+#if LZW_ENABLE_STATS
+
+static thread_local ThreadStages t_stages;
+
+StageScope::StageScope(Stage stage) {
+    ThreadStages& t = t_stages;
+    uint64_t now = statsNow();
+    if (t.depth > 0 && t.depth <= ThreadStages::MAX_DEPTH) {
+        t.stages[static_cast<int>(t.stack[t.depth - 1])].nanoseconds += now - t.mark;
+    }
+    if (t.depth < ThreadStages::MAX_DEPTH) {
+        t.stack[t.depth] = stage;
+        t.stages[static_cast<int>(stage)].calls++;
+    }
+    t.depth++;
+    t.mark = now;
+}
+
+StageScope::~StageScope() {
+    ThreadStages& t = t_stages;
+    uint64_t now = statsNow();
+    if (t.depth <= ThreadStages::MAX_DEPTH) {
+        t.stages[static_cast<int>(t.stack[t.depth - 1])].nanoseconds += now - t.mark;
+    }
+    t.depth--;
+    t.mark = now;
+}
+
+void StageScope::addBytes(uint64_t in, uint64_t out) {
+    ThreadStages& t = t_stages;
+    if (t.depth > 0 && t.depth <= ThreadStages::MAX_DEPTH) {
+        StageCounters& c = t.stages[static_cast<int>(t.stack[t.depth - 1])];
+        c.bytes_in += in;
+        c.bytes_out += out;
+    }
+}
+
+void statsAddEncoder(const CoderCounters& counters) {
+    StatsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.encoder.merge(counters);
+}
+
+void statsAddDecoder(const CoderCounters& counters) {
+    StatsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.decoder.merge(counters);
+}
+
+#endif
+
+// JSON ַת
+static void writeJsonString(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (unsigned char c : s) {
+        switch (c) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+            }
+            else {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+}
+
+static double toMilliseconds(uint64_t ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+
+// ˵жöǼͳƴ뱻ʱҲճ
+static void writeResetSettingsJson(std::ostream& out, const RunInfo& run) {
+    out << "\"ratio_window\":" << run.ratio_window << ",\"ratio_threshold\":" << run.ratio_threshold;
+}
+
+static void writeCoderJson(std::ostream& out, const CoderCounters& c, bool encoder, const RunInfo& run) {
+    out << "{";
+    if (encoder) {
+        writeResetSettingsJson(out, run);
+        out << ",";
+    }
+    out << "\"streams\":" << c.streams
+        << ",\"input_bytes\":" << c.input_bytes
+        << ",\"output_bytes\":" << c.output_bytes
+        << ",\"codes\":" << c.codes;
+    if (encoder) {
+        out << ",\"lookups\":" << c.lookups
+            << ",\"probes\":" << c.probes
+            << ",\"probes_per_lookup\":" << (c.lookups ? static_cast<double>(c.probes) / c.lookups : 0.0);
+    }
+    out << ",\"resets\":" << c.resets
+        << ",\"width_changes\":" << c.width_changes
+        << ",\"dictionary_fills\":" << c.dictionary_fills
+        << ",\"dictionary_fill_ms\":" << toMilliseconds(c.fill_nanoseconds)
+        << ",\"events\":[";
+    static const char* const kinds[] = { "widen", "reset", "full" };
+    for (size_t i = 0; i < c.events.size(); ++i) {
+        const CoderEvent& e = c.events[i];
+        out << (i ? "," : "") << "{\"kind\":\"" << kinds[e.kind] << "\",\"width\":" << int(e.width)
+            << ",\"offset\":" << e.offset << "}";
+    }
+    out << "],\"events_dropped\":" << c.events_dropped << "}";
+}
+
+void writeStatsJson(std::ostream& out, const RunInfo& run) {
+    StageCounters stages[STAGE_COUNT];
+    CoderCounters encoder;
+    CoderCounters decoder;
+    {
+        StatsRegistry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (int i = 0; i < STAGE_COUNT; ++i) {
+            stages[i] = r.retired[i];
+            for (const ThreadStages* t : r.live) {
+                stages[i].nanoseconds += t->stages[i].nanoseconds;
+                stages[i].calls += t->stages[i].calls;
+                stages[i].bytes_in += t->stages[i].bytes_in;
+                stages[i].bytes_out += t->stages[i].bytes_out;
+            }
+        }
+        encoder = r.encoder;
+        decoder = r.decoder;
+    }
+
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"mode\":";
+    writeJsonString(out, run.mode);
+    out << ",\"src\":";
+    writeJsonString(out, run.src);
+    out << ",\"dst\":";
+    writeJsonString(out, run.dst);
+    out << ",\"success\":" << (run.success ? "true" : "false")
+        << ",\"stats_enabled\":" << (LZW_ENABLE_STATS ? "true" : "false")
+        << ",\"archive_version\":" << run.archive_version
+        << ",\"max_code_width\":" << run.max_code_width
+        << ",\"threads\":" << run.threads
+        << ",\"preprocessing\":" << (run.preprocessing ? "true" : "false")
+        << ",\"pipeline\":" << (run.pipeline ? "true" : "false")
+        << ",\"io\":{\"read\":";
+    writeJsonString(out, run.read_backend);
+    out << ",\"write\":";
+    writeJsonString(out, run.write_backend);
+    out << "},\"original_size\":" << run.original_size
+        << ",\"compressed_size\":" << run.compressed_size
+        << ",\"ratio\":" << (run.original_size ? static_cast<double>(run.compressed_size) / run.original_size : 0.0)
+        << ",\"elapsed_ms\":" << toMilliseconds(run.elapsed_nanoseconds)
+        << ",\"throughput_mb_s\":" << (run.elapsed_nanoseconds ? run.original_size * 1e3 / run.elapsed_nanoseconds : 0.0);
+    // ͳƴ뱻ʱȫΪ 0 Ľ׶ñʵֵ
+    if (LZW_ENABLE_STATS) {
+        out << ",\"stages\":{";
+        for (int i = 0; i < STAGE_COUNT; ++i) {
+            const StageCounters& s = stages[i];
+            out << (i ? "," : "") << "\"" << stageName(static_cast<Stage>(i)) << "\":{\"ms\":" << toMilliseconds(s.nanoseconds)
+                << ",\"calls\":" << s.calls << ",\"bytes_in\":" << s.bytes_in << ",\"bytes_out\":" << s.bytes_out << "}";
+        }
+        out << "},\"encoder\":";
+        writeCoderJson(out, encoder, true, run);
+        out << ",\"decoder\":";
+        writeCoderJson(out, decoder, false, run);
+    }
+    else {
+        out << ",\"encoder\":{";
+        writeResetSettingsJson(out, run);
+        out << "}";
+    }
+    out << "}\n";
+    out.flags(flags);
+}
@@ -0,0 +1,138 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+// ͳƣ׶κʱֽȵ
+// ʱ LZW_ENABLE_STATS=0 ȫȥͳƴ룬нӿڱΪղ
+#ifndef LZW_ENABLE_STATS
+#define LZW_ENABLE_STATS 1
+#endif
+
+#if LZW_ENABLE_STATS
+#define LZW_STAT(expr) do { expr; } while (0)
+#else
+#define LZW_STAT(expr) do {} while (0)
+#endif
+
+// ͳƵĽ׶
+enum class Stage {
+    Read,        // ļȡBufferedFileReader
+    Preprocess,  // 滻Ԥָ
+    Code,        // LZW /ѭλ
+    BitPack,     // BitWriter/BitReader 齻
+    Write,       // дļBufferedFileWriter
+    Wait,        // ˮ߳ڻζϵĵȴ
+    Count
+};
+
+// ؽ׶ƣJSON еļ
+const char* stageName(Stage stage);
+
+// һ׶εۼֵʱΪռʱ䣬Ƕ׽׶εĺʱظ
+struct StageCounters {
+    uint64_t nanoseconds = 0;
+    uint64_t calls = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+};
+
+// 仯ֵõ¼ֻǰ MAX_EVENTS 
+struct CoderEvent {
+    enum Kind : uint8_t { Widen, Reset, Full };
+    Kind kind;
+    uint8_t width;
+    uint64_t offset;  // ΪƫƣΪƫƣ
+};
+
+// һļʱȫֻ
+struct CoderCounters {
+    static const size_t MAX_EVENTS = 64;
+
+    uint64_t streams = 0;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;
+    uint64_t codes = 0;
+    uint64_t lookups = 0;          // ˣֵҴ
+    uint64_t probes = 0;           // ˣʱķǿղλ
+    uint64_t resets = 0;
+    uint64_t width_changes = 0;
+    uint64_t dictionary_fills = 0; // ֵдĴ
+    uint64_t fill_nanoseconds = 0; // ʼõֵдۼƺʱ
+    uint64_t events_dropped = 0;
+    std::vector<CoderEvent> events;
+
+    void addEvent(CoderEvent::Kind kind, int width, uint64_t offset) {
+        if (events.size() < MAX_EVENTS) {
+            events.push_back(CoderEvent{ kind, static_cast<uint8_t>(width), offset });
+        }
+        else {
+            ++events_dropped;
+        }
+    }
+
+    void merge(const CoderCounters& other);
+};
+
+// ʱӣ룩
+uint64_t statsNow();
+
+#if LZW_ENABLE_STATS
+
+// ׶μʱʱ׶Σʱ뿪ͬһ߳ϵǶֻѶռʱǸԵĽ׶
+// ʱֻڿȣдá齻ӣϽУÿʱӶȡ
+class StageScope {
+public:
+    explicit StageScope(Stage stage);
+    ~StageScope();
+
+    StageScope(const StageScope&) = delete;
+    StageScope& operator=(const StageScope&) = delete;
+
+    void addBytes(uint64_t in, uint64_t out);
+};
+
+// һļȫֻܣ̰߳ȫ
+void statsAddEncoder(const CoderCounters& counters);
+void statsAddDecoder(const CoderCounters& counters);
+
+#else
+
+class StageScope {
+public:
+    explicit StageScope(Stage) {}
+    void addBytes(uint64_t, uint64_t) {}
+};
+
+inline void statsAddEncoder(const CoderCounters&) {}
+inline void statsAddDecoder(const CoderCounters&) {}
+
+#endif
+
+// вϢ main д
+struct RunInfo {
+    std::string mode;          // zip / unzip / extract
+    std::string src;
+    std::string dst;
+    int archive_version = 0;
+    int max_code_width = 0;
+    int threads = 1;
+    bool preprocessing = false;
+    bool pipeline = false;
+    uint32_t ratio_window = 0;     // ѹʱֵжĴֵѹʱΪ 0
+    double ratio_threshold = 0.0;
+    std::string read_backend;
+    std::string write_backend;
+    uint64_t original_size = 0;
+    uint64_t compressed_size = 0;
+    uint64_t elapsed_nanoseconds = 0;
+    bool success = false;
+};
+
+//  JSON ϢĿǰΪ̵ֹ߳ĻͳƣӦڹ߳̽ã
+void writeStatsJson(std::ostream& out, const RunInfo& run);
+
+#endif
@@ -0,0 +1,67 @@
+#include "suffix_array.h"
+#include <algorithm>
+
+std::vector<int32_t> build_suffix_array(const std::vector<int32_t>& text, int32_t alphabet_size) {
+    const int32_t n = static_cast<int32_t>(text.size());
+    std::vector<int32_t> sa(n), rank(n), order(n), next_rank(n);
+    if (n == 0) return sa;
+
+    // 1. 按首个符号计数排序
+    std::vector<int32_t> count(std::max(alphabet_size, n) + 1, 0);
+    for (int32_t i = 0; i < n; ++i) ++count[text[i] + 1];
+    for (size_t c = 1; c < count.size(); ++c) count[c] += count[c - 1];
+    for (int32_t i = 0; i < n; ++i) sa[count[text[i]]++] = i;
+
+    int32_t classes = 1;
+    rank[sa[0]] = 0;
+    for (int32_t i = 1; i < n; ++i) {
+        if (text[sa[i]] != text[sa[i - 1]]) ++classes;
+        rank[sa[i]] = classes - 1;
+    }
+
+    // 2. 倍增：已按前 k 个符号排好序，再按前 2k 个排序，直到各后缀的名次互不相同
+    for (int32_t k = 1; classes < n; k <<= 1) {
+        // 第二关键字：i + k 越界的后缀最小，其余按 sa 的顺序
+        int32_t p = 0;
+        for (int32_t i = n - k; i < n; ++i) order[p++] = i;
+        for (int32_t i = 0; i < n; ++i) {
+            if (sa[i] >= k) order[p++] = sa[i] - k;
+        }
+
+        // 第一关键字：稳定的计数排序
+        std::fill(count.begin(), count.begin() + classes + 1, 0);
+        for (int32_t i = 0; i < n; ++i) ++count[rank[i] + 1];
+        for (int32_t c = 1; c <= classes; ++c) count[c] += count[c - 1];
+        for (int32_t i = 0; i < n; ++i) sa[count[rank[order[i]]]++] = order[i];
+
+        auto second = [&](int32_t i) { return i + k < n ? rank[i + k] : -1; };
+        classes = 1;
+        next_rank[sa[0]] = 0;
+        for (int32_t i = 1; i < n; ++i) {
+            if (rank[sa[i]] != rank[sa[i - 1]] || second(sa[i]) != second(sa[i - 1])) ++classes;
+            next_rank[sa[i]] = classes - 1;
+        }
+        rank.swap(next_rank);
+    }
+    return sa;
+}
+
+std::vector<int32_t> build_lcp_array(const std::vector<int32_t>& text, const std::vector<int32_t>& sa) {
+    const int32_t n = static_cast<int32_t>(text.size());
+    std::vector<int32_t> rank(n), lcp(n, 0);
+    for (int32_t i = 0; i < n; ++i) rank[sa[i]] = i;
+
+    // 按原文顺序处理后缀，相邻后缀的 LCP 至多减 1
+    int32_t h = 0;
+    for (int32_t i = 0; i < n; ++i) {
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
+        }
+        int32_t j = sa[rank[i] - 1];
+        while (i + h < n && j + h < n && text[i + h] == text[j + h]) ++h;
+        lcp[rank[i]] = h;
+        if (h > 0) --h;
+    }
+    return lcp;
+}
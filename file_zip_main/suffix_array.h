@@ -0,0 +1,14 @@
+#ifndef SUFFIX_ARRAY_H
+#define SUFFIX_ARRAY_H
+
+#include <vector>
+#include <cstdint>
+
+// 后缀数组：倍增法，每轮按 (rank[i], rank[i + k]) 做两次计数排序，O(n log n)
+// text 中的符号取值范围为 [0, alphabet_size)
+std::vector<int32_t> build_suffix_array(const std::vector<int32_t>& text, int32_t alphabet_size);
+
+// LCP 数组（Kasai 算法）：lcp[i] 为 sa[i - 1] 与 sa[i] 两个后缀的最长公共前缀，lcp[0] = 0
+std::vector<int32_t> build_lcp_array(const std::vector<int32_t>& text, const std::vector<int32_t>& sa);
+
+#endif
@@ -0,0 +1,124 @@
+#include "trace.h"
+#include "stats.h"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+
+std::atomic<bool> g_trace_enabled(false);
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    uint64_t start;
+    uint64_t duration;
+    uint64_t bytes;
+};
+
+// 一个线程的环形缓冲区；线程结束后仍由登记表持有，写文件时再统一读取
+struct TraceBuffer {
+    int tid = 0;
+    const char* name = nullptr;
+    std::vector<TraceEvent> events;
+    size_t next = 0;        // 写满后下一个被覆盖的位置
+    uint64_t dropped = 0;   // 被覆盖的事件数
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    size_t capacity = 0;
+    uint64_t origin = 0;
+};
+
+static TraceRegistry& traceRegistry() {
+    // 不析构：理由同 stats.cpp 中的登记表
+    static TraceRegistry* r = new TraceRegistry();
+    return *r;
+}
+
+static thread_local TraceBuffer* t_buffer = nullptr;
+
+static TraceBuffer& threadBuffer() {
+    if (!t_buffer) {
+        TraceRegistry& r = traceRegistry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.emplace_back(new TraceBuffer());
+        t_buffer = r.buffers.back().get();
+        t_buffer->tid = static_cast<int>(r.buffers.size());
+        // 按需增长，短命的工作线程不必一次占满容量
+        t_buffer->events.reserve(std::min<size_t>(r.capacity, 1024));
+    }
+    return *t_buffer;
+}
+
+void traceEnable(size_t events_per_thread) {
+    TraceRegistry& r = traceRegistry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.capacity = std::max<size_t>(events_per_thread, 1);
+        r.origin = statsNow();
+    }
+    g_trace_enabled.store(true, std::memory_order_release);
+}
+
+void traceThreadName(const char* name) {
+    if (traceEnabled()) {
+        threadBuffer().name = name;
+    }
+}
+
+uint64_t TraceScope::now() {
+    return statsNow();
+}
+
+void TraceScope::record() {
+    TraceBuffer& b = threadBuffer();
+    TraceEvent e = { name_, category_, start_, now() - start_, bytes_ };
+    const size_t capacity = traceRegistry().capacity;
+    if (b.events.size() < capacity) {
+        b.events.push_back(e);
+    }
+    else {
+        b.events[b.next] = e;
+        b.next = (b.next + 1) % capacity;
+        b.dropped++;
+    }
+}
+
+bool writeTrace(const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    TraceRegistry& r = traceRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    uint64_t dropped = 0;
+    for (const auto& b : r.buffers) {
+        dropped += b->dropped;
+        if (b->name) {
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+                << ",\"args\":{\"name\":\"" << b->name << "\"}}";
+            first = false;
+        }
+        // 从最旧的事件开始输出
+        for (size_t k = 0; k < b->events.size(); ++k) {
+            const TraceEvent& e = b->events[(b->next + k) % b->events.size()];
+            out << (first ? "" : ",\n") << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid
+                << ",\"ts\":" << (e.start >= r.origin ? e.start - r.origin : 0) / 1e3
+                << ",\"dur\":" << e.duration / 1e3;
+            if (e.bytes) out << ",\"args\":{\"bytes\":" << e.bytes << "}";
+            out << "}";
+            first = false;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+    out.flush();
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <atomic>
+
+// 时间线跟踪（--trace）：记录各作用域的起止时间，结束时写成 Chrome/Perfetto 的 trace-event JSON，
+// 可以在 chrome://tracing 或 ui.perfetto.dev 中打开
+// 每个线程只写自己的环形缓冲区，不加锁；缓冲区写满后覆盖最旧的事件
+// 没有打开跟踪时，每个作用域只多一次原子读
+
+extern std::atomic<bool> g_trace_enabled;
+
+// 打开跟踪，时间轴从此刻开始；events_per_thread 为每个线程保留的事件数
+void traceEnable(size_t events_per_thread = 1 << 16);
+
+inline bool traceEnabled() {
+    return g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// 给当前线程命名（显示在时间线的线程行上）；name 须是字符串字面量
+void traceThreadName(const char* name);
+
+// 作用域计时：构造时开始，析构时记录一个完整事件
+// name、category 须是字符串字面量（只保存指针）
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* category)
+        : name_(traceEnabled() ? name : nullptr), category_(category), bytes_(0), start_(name_ ? now() : 0) {}
+    ~TraceScope() {
+        if (name_) record();
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // 附加到事件上的字节数（args.bytes）
+    void setBytes(uint64_t bytes) { bytes_ = bytes; }
+
+private:
+    const char* name_;
+    const char* category_;
+    uint64_t bytes_;
+    uint64_t start_;
+
+    static uint64_t now();
+    void record();
+};
+
+// 把所有线程的事件写到 path；应在工作线程都结束之后调用
+bool writeTrace(const std::string& path);
+
+#endif